@@ -0,0 +1,36 @@
+#ifndef MODULE_ALLOC_H
+#define MODULE_ALLOC_H
+
+#include <stddef.h>
+
+// Allocation counters; bytes are what callers asked for, not what the pool reserved
+typedef struct {
+    size_t live_bytes;
+    size_t peak_bytes;
+    size_t pool_bytes;               // reserved in small-object pages
+    unsigned long long total_allocs;
+    unsigned int frame_allocs;       // allocations during the last completed frame
+    size_t frame_bytes;
+} AllocStats;
+
+// Size-class pool: requests up to ALLOC_SMALL_MAX bytes come from per-class free lists
+// carved out of 64 KiB pages, larger ones go straight to malloc. Not thread safe; one
+// pool serves one Lua state.
+#define ALLOC_SMALL_MAX 256
+
+typedef struct AllocPool AllocPool;
+
+AllocPool* alloc_pool_create(void);
+
+// Frees every page, including blocks still in use
+void alloc_pool_destroy(AllocPool *pool);
+
+// lua_Alloc-compatible entry point; pass the pool as ud to lua_newstate
+void* alloc_pool_lua_alloc(void *ud, void *ptr, size_t osize, size_t nsize);
+
+// Close the current frame's counters (frame_allocs/frame_bytes report the closed frame)
+void alloc_pool_end_frame(AllocPool *pool);
+
+void alloc_pool_get_stats(const AllocPool *pool, AllocStats *stats);
+
+#endif // MODULE_ALLOC_H
@@ -0,0 +1,58 @@
+#ifndef MODULE_EVAL_H
+#define MODULE_EVAL_H
+
+#include <lua.h>
+#include <stdbool.h>
+#include "module_node.h"
+
+// Dataflow evaluation of the node graph. eval_compile turns the connections into a
+// topological schedule (Kahn's algorithm) with each node's incoming edges packed next to
+// it; eval_run then calls every node's kernel once, in order, and caches one number per
+// output. An input's value is the sum of the outputs connected to it (0 when none).
+//
+// Kernels, chosen by the node's `kernel` field:
+//   "" or "pass"  output j = input j
+//   "const"       every output = value
+//   "add"         every output = value + sum of inputs
+//   "mul"         every output = value * product of inputs
+//   other names   kernels[name](value, input1, ..., inputN) in Lua, returning the outputs
+//
+// Once attached, the graph listens to the store and to L's connections: a value edit marks
+// its node dirty, a connection edit marks the target node dirty and schedules a recompile,
+// and eval_update re-runs only the dirty nodes and everything downstream of them.
+typedef struct EvalGraph EvalGraph;
+
+typedef struct {
+    int evaluated;       // nodes re-run
+    int skipped;         // scheduled nodes whose cached outputs were still valid
+    bool recompiled;     // connections, kernels or connector counts changed since the last update
+} EvalStats;
+
+EvalGraph* eval_create(void);
+
+// Detaches from the store and state it was attached to
+void eval_destroy(EvalGraph *graph, lua_State *L);
+
+// Build the schedule for the store and L's connections. Returns false when the graph has
+// a cycle; nodes on or behind it are left out of the schedule and keep outputs of 0.
+// Cached outputs survive when every node keeps its output count; otherwise they are reset
+// and the next update runs everything. Attached graphs recompile on their own.
+bool eval_compile(EvalGraph *graph, lua_State *L, const NodeStore *store);
+
+// Install the graph as the store's change listener and L's connection listener
+void eval_attach(EvalGraph *graph, lua_State *L, NodeStore *store);
+
+// Evaluate every scheduled node; returns how many ran
+int eval_run(EvalGraph *graph, lua_State *L, const NodeStore *store);
+
+// Re-run the nodes made dirty since the last run or update, in schedule order; stats may
+// be NULL. Returns how many ran.
+int eval_update(EvalGraph *graph, lua_State *L, const NodeStore *store, EvalStats *stats);
+
+// Cached value of a node's 0-based output, 0 when out of range
+double eval_output(const EvalGraph *graph, int index, int output);
+
+// Nodes in the schedule
+int eval_scheduled_count(const EvalGraph *graph);
+
+#endif // MODULE_EVAL_H
@@ -5,10 +5,57 @@
 #include <SDL3_ttf/SDL_ttf.h>
 #include <glad/gl.h>
 
+// Per-instance record for nodes and connectors drawn with glDrawArraysInstanced
+typedef struct {
+    float x, y;      // center in world space
+    float size;      // edge length for rects, radius for circles and rings
+    float param;     // corner radius for rects, stroke width for rings
+    Uint8 r, g, b, a;
+    Uint32 flags;    // RENDER_INSTANCE_* bits, shape in bits 8..15
+} RenderInstance;
+
+#define RENDER_INSTANCE_HIGHLIGHTED (1u << 0) // drawn 1.2x larger
+#define RENDER_INSTANCE_SELECTED (1u << 1)    // drawn 1.2x larger; compounds with HIGHLIGHTED
+
+// SDF shapes evaluated by the instance fragment shader
+#define RENDER_SHAPE_CIRCLE 0u
+#define RENDER_SHAPE_ROUNDED_RECT 1u
+#define RENDER_SHAPE_RING 2u
+#define RENDER_INSTANCE_SHAPE(shape) ((shape) << 8)
+
 SDL_GLContext init_opengl_context(SDL_Window *window);
-void render_square(float x, float y, float size, float r, float g, float b, SDL_Window *window, float cam_x, float cam_y, float cam_scale);
-void render_circle(float x, float y, float radius, float r, float g, float b, SDL_Window *window, float cam_x, float cam_y, float cam_scale);
-void render_text(const char *text, float x, float y, TTF_Font *font, SDL_Window *window, float cam_x, float cam_y, float cam_scale);
-void render_line(float x1, float y1, float x2, float y2, float r, float g, float b, SDL_Window *window, float cam_x, float cam_y, float cam_scale);
+void cleanup_opengl_context(SDL_GLContext gl_context);
+
+// Cached window size; call on SDL_EVENT_WINDOW_RESIZED
+void render_resize(int win_width, int win_height);
+
+// Frame batching: begin sets the camera, push appends vertices, flush draws them
+void render_begin_frame(float cam_x, float cam_y, float cam_scale);
+void render_push_quad(float x1, float y1, float x2, float y2, float r, float g, float b, float a);
+void render_push_fan(const float *points, int point_count, float r, float g, float b, float a);
+void render_push_line(float x1, float y1, float x2, float y2, float r, float g, float b, float a);
+void render_flush(void);
+
+// Viewport culling against the world rectangle visible in the current frame
+void render_get_visible_rect(float *min_x, float *min_y, float *max_x, float *max_y);
+bool render_rect_visible(float min_x, float min_y, float max_x, float max_y);
+bool render_segment_visible(float x1, float y1, float x2, float y2);
+
+// Zoomed-out level of detail: bin node bounds into screen tiles of tile_pixels and
+// emit one quad per occupied tile into the solid batch on end
+void render_tiles_begin(float tile_pixels);
+void render_tiles_mark(float min_x, float min_y, float max_x, float max_y, float r, float g, float b);
+void render_tiles_end(void);
+
+// Instanced SDF shapes, drawn in one call per list on flush (nodes, then connectors and rings)
+void render_push_node(float x, float y, float size, float corner_radius, float r, float g, float b, unsigned int flags);
+void render_push_connector(float x, float y, float radius, float r, float g, float b, unsigned int flags);
+void render_push_ring(float x, float y, float radius, float thickness, float r, float g, float b, unsigned int flags);
+
+void render_square(float x, float y, float size, float r, float g, float b);
+void render_circle(float x, float y, float radius, float r, float g, float b);
+void render_text(const char *text, float x, float y, TTF_Font *font);
+bool render_measure_text(const char *text, TTF_Font *font, int *w, int *h);
+void render_line(float x1, float y1, float x2, float y2, float r, float g, float b);
 
-#endif // MODULE_GL_H
\ No newline at end of file
+#endif // MODULE_GL_H
@@ -0,0 +1,85 @@
+#ifndef MODULE_LOG_H
+#define MODULE_LOG_H
+
+#include <stdbool.h>
+
+// Log levels, lowest to highest severity
+#define LOG_LEVEL_TRACE 0
+#define LOG_LEVEL_DEBUG 1
+#define LOG_LEVEL_INFO 2
+#define LOG_LEVEL_WARN 3
+#define LOG_LEVEL_ERROR 4
+#define LOG_LEVEL_OFF 5
+
+// Calls below this level are removed by the preprocessor (set from CMake)
+#ifndef LOG_COMPILE_LEVEL
+#define LOG_COMPILE_LEVEL LOG_LEVEL_TRACE
+#endif
+
+typedef enum {
+    LOG_CATEGORY_GENERAL = 0,
+    LOG_CATEGORY_INPUT,
+    LOG_CATEGORY_RENDER,
+    LOG_CATEGORY_LUA,
+    LOG_CATEGORY_EVAL,
+    LOG_CATEGORY_COUNT
+} LogCategory;
+
+// Runtime threshold per category, read inline by the LOG_* macros
+extern unsigned char log_category_levels[LOG_CATEGORY_COUNT];
+
+// Start the background writer thread; before this (and after shutdown) messages are written synchronously
+bool log_init(void);
+
+// Drain pending messages and stop the writer thread
+void log_shutdown(void);
+
+// Set the runtime level of one category, or of all of them
+void log_set_level(LogCategory category, int level);
+void log_set_all_levels(int level);
+
+// Parse "trace", "debug", "info", "warn", "error" or "off"; returns default_level otherwise
+int log_level_from_string(const char *name, int default_level);
+
+// Messages dropped because the ring buffer was full
+unsigned int log_dropped_count(void);
+
+// Format into the ring buffer; use the LOG_* macros so disabled levels cost nothing
+void log_write(LogCategory category, int level, const char *fmt, ...);
+
+#define LOG_ENABLED(category, level) ((level) >= log_category_levels[(category)])
+
+#define LOG_AT(category, level, ...) \
+    do { if (LOG_ENABLED(category, level)) log_write((category), (level), __VA_ARGS__); } while (0)
+
+#if LOG_COMPILE_LEVEL <= LOG_LEVEL_TRACE
+#define LOG_TRACE(category, ...) LOG_AT(category, LOG_LEVEL_TRACE, __VA_ARGS__)
+#else
+#define LOG_TRACE(category, ...) ((void)0)
+#endif
+
+#if LOG_COMPILE_LEVEL <= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(category, ...) LOG_AT(category, LOG_LEVEL_DEBUG, __VA_ARGS__)
+#else
+#define LOG_DEBUG(category, ...) ((void)0)
+#endif
+
+#if LOG_COMPILE_LEVEL <= LOG_LEVEL_INFO
+#define LOG_INFO(category, ...) LOG_AT(category, LOG_LEVEL_INFO, __VA_ARGS__)
+#else
+#define LOG_INFO(category, ...) ((void)0)
+#endif
+
+#if LOG_COMPILE_LEVEL <= LOG_LEVEL_WARN
+#define LOG_WARN(category, ...) LOG_AT(category, LOG_LEVEL_WARN, __VA_ARGS__)
+#else
+#define LOG_WARN(category, ...) ((void)0)
+#endif
+
+#if LOG_COMPILE_LEVEL <= LOG_LEVEL_ERROR
+#define LOG_ERROR(category, ...) LOG_AT(category, LOG_LEVEL_ERROR, __VA_ARGS__)
+#else
+#define LOG_ERROR(category, ...) ((void)0)
+#endif
+
+#endif // MODULE_LOG_H
@@ -4,25 +4,115 @@
 #include <lua.h>
 #include <lauxlib.h>
 #include <lualib.h>
-
-// Initialize Lua and load script
+#include <stdbool.h>
+#include <SDL3/SDL.h>
+#include "module_alloc.h"
+
+// Snapshot of one entry of the global nodes table
+typedef struct {
+    float x, y;
+    float size;
+    float r, g, b;
+    int inputs, outputs;
+    const char *text; // owned by Lua; valid until the node's text field changes
+    int id;           // script id; defaults to the node's 1-based position
+    const char *kernel; // evaluation kernel name, "" for passthrough; owned like text
+    float value;      // kernel parameter
+} LuaNode;
+
+// Node fields scripts can name, in the order lua_utils interns their keys
+typedef enum {
+    LUA_NODE_FIELD_X, LUA_NODE_FIELD_Y, LUA_NODE_FIELD_SIZE, LUA_NODE_FIELD_R, LUA_NODE_FIELD_G, LUA_NODE_FIELD_B,
+    LUA_NODE_FIELD_INPUTS, LUA_NODE_FIELD_OUTPUTS, LUA_NODE_FIELD_TEXT, LUA_NODE_FIELD_ID, LUA_NODE_FIELD_KERNEL,
+    LUA_NODE_FIELD_VALUE,
+    LUA_NODE_FIELD_COUNT
+} LuaNodeField;
+
+// Node ids are small positive integers; connections index their endpoints by id
+#define LUA_NODE_ID_MAX 0x3fffff
+
+// One connection (node ids, 1-based connector indices). Scripts assign a table of these to
+// the connections global once; from then on `connections` is a read-only view and edits go
+// through add_connection and remove_connection.
+typedef struct {
+    int from_node, from_output;
+    int to_node, to_input;
+} LuaConnection;
+
+// Told after a connection was added or before one is removed through lua_utils; connection
+// is NULL when a script assigned a new connections table
+typedef void (*LuaConnectionListener)(void *user, const LuaConnection *connection, bool added);
+
+#define LUA_PATH_MAX_DEPTH 8
+
+// Dotted key chain such as config.camera.x, parsed once; every segment is held as a
+// registry reference so lookups never re-hash or re-split the string
+typedef struct {
+    int root_tracked;                 // cached global index, or -1 to look the root up in _G
+    int root_ref;                     // root name, used when root_tracked is -1
+    int depth;
+    int key_refs[LUA_PATH_MAX_DEPTH];
+} LuaPath;
+
+// Initialize Lua and run the script. Compiled bytecode is cached in "<script>.cache" and
+// reused while the script's size and mtime (or, failing that, content hash) match.
 lua_State* lua_utils_init(const char *script_path);
 
 // Cleanup Lua
 void lua_utils_cleanup(lua_State *L);
 
+// Table getters and setters accept dotted keys ("camera.x") for nested tables
+
 // Get string from table
 const char* lua_utils_get_string(lua_State *L, const char *table, const char *key, const char *default_value);
 
 // Get integer from table
 int lua_utils_get_integer(lua_State *L, const char *table, const char *key, int default_value);
 
+// Get boolean from table
+bool lua_utils_get_boolean(lua_State *L, const char *table, const char *key, bool default_value);
+
 // Get number from table
 float lua_utils_get_number(lua_State *L, const char *table, const char *key, float default_value);
 
 // Set number in table
 void lua_utils_set_number(lua_State *L, const char *table, const char *key, float value);
 
+// Allocator counters of the state (also available to scripts as memory_stats())
+void lua_utils_memory_stats(lua_State *L, AllocStats *stats);
+
+// Close the per-frame allocation counters; call once per rendered frame
+void lua_utils_end_frame(lua_State *L);
+
+// Apply config.gc: "generational" or "incremental" mode and tuning. With an incremental
+// budget_ms above 0 the automatic collector is stopped and lua_utils_gc_step does the work.
+void lua_utils_configure_gc(lua_State *L);
+
+// Run incremental GC steps for at most min(budget_ms, available_ns); returns steps taken
+int lua_utils_gc_step(lua_State *L, Uint64 available_ns);
+
+// Hand collection back to Lua's automatic collector, for callers without frames to step in
+void lua_utils_gc_automatic(lua_State *L);
+
+// Ask for another frame, as request_redraw() does from scripts
+void lua_utils_request_redraw(lua_State *L);
+
+// True once after a script assigned a new value to the nodes global
+bool lua_utils_nodes_replaced(lua_State *L);
+
+// True when a script called request_redraw() since the last check or sets config.animate
+bool lua_utils_redraw_requested(lua_State *L);
+
+// Call the script's on_frame(dt) if it defines one; dt is seconds since the previous frame.
+// Errors are logged and the frame goes on.
+void lua_utils_run_frame(lua_State *L, double dt);
+
+// Node accessors honor metamethods, so they work on tables and on node proxies
+
+// Node field named by the value at index, matched by address against the interned keys
+// rather than with string compares; -1 when it is not a node field name
+int lua_utils_node_field(lua_State *L, int index);
+
 // Get node count
 int lua_utils_get_nodes_count(lua_State *L);
 
@@ -44,10 +134,64 @@ int lua_utils_get_connections_count(lua_State *L);
 // Get connection details
 void lua_utils_get_connection(lua_State *L, int conn_index, int *from_node, int *from_output, int *to_node, int *to_input);
 
+// All connections as a dense array mirroring connections[1..count]; valid until the next edit
+const LuaConnection* lua_utils_get_connections(lua_State *L, int *count);
+
+// Indices (0-based, into lua_utils_get_connections) of edges ending at or starting from a node
+const int* lua_utils_get_node_edges(lua_State *L, int node_id, bool incoming, int *count);
+
 // Add connection
 void lua_utils_add_connection(lua_State *L, int from_node, int from_output, int to_node, int to_input);
 
-// Remove connections involving a connector
-void lua_utils_remove_connections(lua_State *L, int node_index, const char *type, int connector_index);
+// Remove connections involving a connector; O(degree), and the connections table is
+// edited in place (the last entry moves into each freed slot)
+void lua_utils_remove_connections(lua_State *L, int node_id, const char *type, int connector_index);
+
+// True when an identical connection exists; O(degree of its source node)
+bool lua_utils_has_connection(lua_State *L, const LuaConnection *connection);
+
+// Remove one connection equal to the given one; false when there is none
+bool lua_utils_remove_connection(lua_State *L, const LuaConnection *connection);
+
+// Remove every connection starting or ending at a node; O(degree)
+void lua_utils_remove_node_connections(lua_State *L, int node_id);
+
+// Install (or with NULL, clear) the single connection listener of the state
+void lua_utils_set_connection_listener(lua_State *L, LuaConnectionListener listener, void *user);
+
+// Copy config entries of `from` (another state) whose values differ into L's config,
+// descending into nested tables; the top-level skip_key is left alone and functions are
+// not copied. Returns the number of values written.
+int lua_utils_merge_config(lua_State *L, lua_State *from, const char *skip_key);
+
+// Read up to max_count nodes in one pass over a plain nodes table; returns the table
+// length (0 once nodes are bound to proxies, which read the C store directly). The ids
+// read are distinct and in range: nodes without a positive id get their position when it
+// is free, and duplicates or out-of-range ids after the first get fresh ones (logged).
+int lua_utils_read_nodes(lua_State *L, LuaNode *nodes, int max_count);
+
+// Copy up to max_count connections; returns how many there are
+int lua_utils_read_connections(lua_State *L, LuaConnection *connections, int max_count);
+
+// Write count nodes back into nodes[1..count], keeping any other fields scripts added
+void lua_utils_write_nodes(lua_State *L, const LuaNode *nodes, int count);
+
+// Replace every connection with the count given
+void lua_utils_write_connections(lua_State *L, const LuaConnection *connections, int count);
+
+// Compile "table.key.subkey" into path; false when it is malformed or too deep
+bool lua_utils_path_compile(lua_State *L, LuaPath *path, const char *path_string);
+
+// Release the registry references held by a compiled path
+void lua_utils_path_release(lua_State *L, LuaPath *path);
+
+// Read a number through a compiled path
+float lua_utils_path_get_number(lua_State *L, const LuaPath *path, float default_value);
+
+// Read a boolean through a compiled path; default_value when missing or not a boolean
+bool lua_utils_path_get_boolean(lua_State *L, const LuaPath *path, bool default_value);
+
+// Write a number through a compiled path, creating missing intermediate tables
+void lua_utils_path_set_number(lua_State *L, const LuaPath *path, float value);
 
 #endif // MODULE_LUA_H
\ No newline at end of file
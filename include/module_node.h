@@ -0,0 +1,127 @@
+#ifndef MODULE_NODE_H
+#define MODULE_NODE_H
+
+#include <lua.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// Stable reference to a node: slot in the low bits, the slot's generation above. Removing
+// a node bumps its slot's generation, so stale handles fail to resolve instead of naming
+// whichever node reuses the slot. 0 is never a valid handle.
+typedef uint32_t NodeHandle;
+
+#define NODE_HANDLE_NONE 0u
+#define NODE_HANDLE_SLOT_BITS 22
+#define NODE_HANDLE_SLOT_MASK ((1u << NODE_HANDLE_SLOT_BITS) - 1u)
+#define NODE_HANDLE_GENERATION_MAX ((1u << (32 - NODE_HANDLE_SLOT_BITS)) - 1u)
+
+// Told when evaluation inputs of a node change: its value (structural false), or its kernel
+// or connector counts (structural true). index is -1 when nodes were added or removed.
+typedef void (*NodeChangeListener)(void *user, int index, bool structural);
+
+// Authoritative node data in structure-of-arrays form, indexed 0..count-1.
+// Lua's `nodes` table is read once on load; after node_store_bind_lua scripts
+// see userdata proxies that read and write these arrays directly.
+// Removal moves the last node into the hole, so indices are only valid until the next
+// removal; hold a NodeHandle (or the script id) across edits instead.
+typedef struct {
+    int count;
+    int capacity;
+    float *x, *y;
+    float *size;
+    float *r, *g, *b;
+    int *inputs, *outputs;
+    int *text_id;          // offset into text_pool
+    int *kernel_id;        // offset into text_pool of the evaluation kernel name
+    float *value;          // kernel parameter
+    int *id;               // script id; connections refer to nodes by it
+    int *slot;             // handle slot owning each index
+    char *text_pool;       // NUL-terminated labels, packed back to back
+    int text_pool_size;
+    int text_pool_capacity;
+    // Slot map behind NodeHandle
+    int *slot_index;       // index of the slot's node, or the next free slot while free
+    uint16_t *slot_generation;
+    int slot_count;        // slots handed out so far
+    int slot_capacity;
+    int free_slot;         // -1 when every slot is in use
+    // Script id -> index, -1 when unused
+    int *id_index;
+    int id_capacity;
+    int next_id;           // one past the highest id in use; given to nodes added without one
+    // Bumped when nodes are added, removed or cleared, or fields are written in bulk; the
+    // spatial index then rebuilds. node_store_set_position callers update it themselves.
+    unsigned int geometry_version;
+    // Nodes whose position, size or connector counts scripts changed since the last
+    // spatial_sync, which re-indexes just these
+    NodeHandle *moved;
+    int moved_count;
+    int moved_capacity;
+    NodeChangeListener listener;  // NULL when nobody listens
+    void *listener_user;
+} NodeStore;
+
+// Vertical distance between connectors on one side of a node
+#define NODE_CONNECTOR_SPACING 20.0f
+
+void node_store_init(NodeStore *store);
+void node_store_free(NodeStore *store);
+
+// Drop all nodes but keep the allocations
+void node_store_clear(NodeStore *store);
+
+// Append a node; returns its index or -1 when out of memory. An id that is not positive,
+// out of range or already taken is replaced by next_id.
+int node_store_add(NodeStore *store, int id, float x, float y, float size, float r, float g, float b,
+                   int inputs, int outputs, const char *text);
+
+// Remove a node in O(1): the last node moves into its index. Returns the index the moved
+// node had (the new count), or -1 when nothing moved. Connections are not touched. Index
+// order is draw order and hit priority, so the moved node changes layer.
+int node_store_remove(NodeStore *store, int index);
+
+// Handle of the node at index, NODE_HANDLE_NONE when out of range
+NodeHandle node_store_handle(const NodeStore *store, int index);
+
+// Current index of a handle's node, or -1 when it was removed
+int node_store_index(const NodeStore *store, NodeHandle handle);
+
+// Index of the node with a script id, or -1
+int node_store_find_id(const NodeStore *store, int id);
+
+// Label of a node ("" when it has none)
+const char* node_store_text(const NodeStore *store, int index);
+
+// Move a node
+void node_store_set_position(NodeStore *store, int index, float x, float y);
+
+// Center of a node's 0-based input (left edge) or output (right edge) connector
+void node_store_connector_position(const NodeStore *store, int index, bool output, int connector, float *x, float *y);
+
+// Queue a node for re-indexing after its geometry changed; past one entry per node this
+// falls back to bumping geometry_version, as a rebuild is then cheaper
+void node_store_mark_moved(NodeStore *store, int index);
+
+// Replace a node's label; the old text stays in the pool until the next load
+bool node_store_set_text(NodeStore *store, int index, const char *text);
+
+// Install (or with NULL, clear) the change listener; node_store_clear keeps it
+void node_store_set_listener(NodeStore *store, NodeChangeListener listener, void *user);
+
+// Report a change made by writing the arrays directly (value, inputs, outputs)
+void node_store_notify(NodeStore *store, int index, bool structural);
+
+// Evaluation kernel name of a node ("" for passthrough)
+const char* node_store_kernel(const NodeStore *store, int index);
+
+// Replace a node's kernel name; pooled like labels. Notifies the listener.
+bool node_store_set_kernel(NodeStore *store, int index, const char *kernel);
+
+// Replace the store contents with the global `nodes` table (no-op when it is already bound)
+bool node_store_load_lua(NodeStore *store, lua_State *L);
+
+// Replace the global `nodes` with a proxy over the store: #nodes, nodes[i].x, nodes[i].x = v.
+// The store must stay valid while scripts can run.
+void node_store_bind_lua(NodeStore *store, lua_State *L);
+
+#endif // MODULE_NODE_H
@@ -0,0 +1,31 @@
+#ifndef MODULE_RELOAD_H
+#define MODULE_RELOAD_H
+
+#include <lua.h>
+#include <stdbool.h>
+#include "module_lua.h"
+#include "module_node.h"
+
+// Nodes and connections as the script file declared them at its last load. A reload
+// diffs the new file against this rather than against the live graph, so nodes moved
+// and connections made in the editor survive unless the script changed the same entry.
+typedef struct {
+    LuaNode *nodes;              // text and kernel point into text_pool
+    int node_count;
+    char *text_pool;
+    LuaConnection *connections;
+    int connection_count;
+} ScriptSnapshot;
+
+// Copy nodes and connections out of a state whose nodes global is still a plain table
+bool script_snapshot_take(lua_State *L, ScriptSnapshot *snapshot);
+
+void script_snapshot_free(ScriptSnapshot *snapshot);
+
+// Run script_path in a scratch state and apply what changed since baseline to the live
+// state and store: node fields (nodes are matched by id), added and removed nodes and
+// connections, and config values other than config.camera. On success baseline becomes
+// the new version; on a script error nothing is touched and false is returned.
+bool script_reload(lua_State *L, NodeStore *store, const char *script_path, ScriptSnapshot *baseline);
+
+#endif // MODULE_RELOAD_H
@@ -0,0 +1,46 @@
+#ifndef MODULE_SPATIAL_H
+#define MODULE_SPATIAL_H
+
+#include <stdbool.h>
+#include "module_node.h"
+
+// Uniform hash grid over node bodies (their squares, which may span cells) and connector
+// centers (one cell each). Hit tests look only at the cells under the query, so hover and
+// click cost depends on local density, not on the size of the graph.
+typedef enum {
+    SPATIAL_INPUT = 0,   // connector kinds sort before the body
+    SPATIAL_OUTPUT = 1,
+    SPATIAL_BODY = 2
+} SpatialKind;
+
+typedef struct {
+    int node;            // 0-based node index
+    int kind;            // SpatialKind
+    int connector;       // 0-based connector index, -1 for a body
+} SpatialHit;
+
+typedef struct SpatialGrid SpatialGrid;
+
+SpatialGrid* spatial_create(float cell_size);
+void spatial_destroy(SpatialGrid *grid);
+
+// Rebuild from scratch when the store's geometry_version moved since the last sync;
+// otherwise re-index only the nodes on the store's moved list. Empties that list.
+void spatial_sync(SpatialGrid *grid, NodeStore *store);
+
+// Re-index one node after node_store_set_position; O(cells covered + connectors)
+void spatial_update_node(SpatialGrid *grid, const NodeStore *store, int index);
+
+// Follow node_store_remove(store, index) == moved_from without a rebuild: drop the removed
+// node's entries and relabel the moved node's; O(cells covered + connectors)
+void spatial_remove_node(SpatialGrid *grid, const NodeStore *store, int index, int moved_from);
+
+// Connectors whose center lies within radius of (x, y), ordered by node, then inputs
+// before outputs, then connector index; returns how many were written (at most max_hits)
+int spatial_query_connectors(const SpatialGrid *grid, const NodeStore *store, float x, float y, float radius,
+                             SpatialHit *hits, int max_hits);
+
+// Lowest-indexed node whose square contains (x, y), or -1
+int spatial_query_body(const SpatialGrid *grid, const NodeStore *store, float x, float y);
+
+#endif // MODULE_SPATIAL_H
@@ -0,0 +1,18 @@
+#ifndef MODULE_WATCH_H
+#define MODULE_WATCH_H
+
+#include <SDL3/SDL.h>
+
+// Watches one file from a background thread and pushes an SDL event of the given type
+// whenever it is saved, so an idle SDL_WaitEvent loop wakes up for it. Linux uses
+// inotify on the containing directory (editors often save by renaming over the file);
+// elsewhere, or when inotify is unavailable, the modification time is polled.
+typedef struct FileWatch FileWatch;
+
+// Start watching path; returns NULL when the thread cannot be started
+FileWatch* watch_start(const char *path, Uint32 event_type);
+
+// Stop the thread and free the watch (NULL is ignored)
+void watch_stop(FileWatch *watch);
+
+#endif // MODULE_WATCH_H
@@ -5,6 +5,25 @@ config = {
     font_path = "Kenney Mini.ttf",
     font_size = 24,
     text = "Two Node2D Test",
+    animate = false, -- true redraws every frame; otherwise frames follow input or request_redraw()
+    log_level = "info", -- trace, debug, info, warn, error or off
+    hot_reload = true, -- apply edits to this file while running (font and window size need a restart)
+    gc = {
+        mode = "incremental",  -- or "generational"
+        pause = 200,           -- incremental: heap growth (percent) before a new cycle
+        stepmul = 100,         -- incremental: work per step
+        stepsize = 13,         -- incremental: log2 of bytes per step
+        minor_multiplier = 20, -- generational tuning
+        major_multiplier = 100,
+        budget_ms = 1.0,       -- incremental GC work per frame; 0 keeps collection automatic
+        frame_ms = 16.0        -- frame deadline the GC budget must fit in
+    },
+    -- Level of detail: camera scale thresholds for zoomed-out views
+    lod_label_min_scale = 0.5,      -- hide node labels below this scale
+    lod_connector_min_scale = 0.35, -- collapse connectors below this scale
+    lod_tile_max_scale = 0.15,      -- aggregate nodes into screen tiles below this scale
+    lod_tile_size = 4,              -- tile edge in pixels
+    spatial_cell_size = 128,        -- hit-test grid cell edge in world units
     camera = {
         x = 0,
         y = 0,
@@ -12,8 +31,11 @@ config = {
     }
 }
 
+-- Each node may carry an id (a small positive integer); connections refer to nodes by id,
+-- so deleting a node never renumbers the others. Nodes without one get their position.
 nodes = {
     {
+        id = 1,
         x = 255,
         y = 225,
         size = 100,
@@ -22,9 +44,12 @@ nodes = {
         b = 0.0,
         text = "Node 1",
         inputs = 1,
-        outputs = 1
+        outputs = 1,
+        kernel = "const",
+        value = 1.0
     },
     {
+        id = 2,
         x = 586,
         y = 337,
         size = 80,
@@ -33,10 +58,31 @@ nodes = {
         b = 1.0,
         text = "Node 2",
         inputs = 1,
-        outputs = 1
+        outputs = 1,
+        kernel = "scale",
+        value = 2.0
     }
 }
 
+-- Evaluation (run headless with --eval N): each node's `kernel` is "pass" (the default),
+-- "const", "add", "mul" or a function of this table. Lua kernels receive the node's
+-- `value` and its inputs and return one number per output.
+kernels = {
+    scale = function(value, input) return value * input end
+}
+
+-- Called before each rendered frame with the seconds since the previous one. Frames only
+-- follow input unless config.animate is set; call request_redraw() here to keep them coming.
+-- Like kernels, functions are not picked up by hot reload; restart after changing it.
+-- function on_frame(dt)
+--     request_redraw()
+-- end
+
+-- Assigning this table sets the starting connections. After that, `connections` is a
+-- read-only view: read connections[i].from_node and so on, and change the graph with
+-- add_connection(from_node, from_output, to_node, to_input) and
+-- remove_connection(from_node, from_output, to_node, to_input). Assigning a new table
+-- replaces every connection.
 connections = {
-    -- Example: { from_node=1, from_output=1, to_node=2, to_input=1 }
+    -- Example: { from_node=1, from_output=1, to_node=2, to_input=1 } (node ids)
 }
\ No newline at end of file
@@ -1,33 +1,199 @@
 #include <SDL3/SDL.h>
 #include <SDL3_ttf/SDL_ttf.h>
 #include <glad/gl.h>
+#include "module_eval.h"
 #include "module_gl.h"
 #include "module_lua.h"
+#include "module_log.h"
+#include "module_node.h"
+#include "module_reload.h"
+#include "module_spatial.h"
+#include "module_watch.h"
 #include <math.h>
 #include <stdbool.h>
 
+// Camera owned by C; config.camera is refreshed from it once per rendered frame
+typedef struct {
+    float x, y, scale;
+    bool dirty; // changed since the last write-back
+} Camera;
+
+// Dragging, panning, connection and hover state. Nodes held across events are handles,
+// which survive deletions; the hover target is recomputed on every motion and stays a
+// 1-based index (0 for none).
+typedef struct {
+    bool is_dragging, is_panning, is_connecting;
+    float drag_offset_x, drag_offset_y;
+    NodeHandle dragged_node;
+    float pan_start_x, pan_start_y;
+    NodeHandle from_node;                // connection start
+    int from_output;
+    float mouse_x, mouse_y;              // latest pointer position in window coordinates
+    int highlighted_node, highlighted_connector;
+    const char *highlighted_type;        // "input", "output" or ""
+    int motion_events;                   // motion events since the position was last applied
+} PointerState;
+
+// Connector pick radius in world units
+#define CONNECTOR_PICK_RADIUS 15.0f
+
+// Apply the latest pointer position once: hover, then drag or pan. Returns true when the
+// frame has to be redrawn.
+static bool apply_pointer_motion(PointerState *pointer, Camera *camera, NodeStore *nodes, SpatialGrid *spatial) {
+    if (pointer->motion_events > 1) {
+        LOG_TRACE(LOG_CATEGORY_INPUT, "Coalesced %d motion events", pointer->motion_events);
+    }
+    pointer->motion_events = 0;
+    float cam_x = camera->x;
+    float cam_y = camera->y;
+    float cam_scale = camera->scale;
+    float world_x = pointer->mouse_x / cam_scale + cam_x;
+    float world_y = pointer->mouse_y / cam_scale + cam_y;
+
+    // Check for connector hover
+    int previous_node = pointer->highlighted_node, previous_connector = pointer->highlighted_connector;
+    const char *previous_type = pointer->highlighted_type;
+    pointer->highlighted_node = 0;
+    pointer->highlighted_connector = 0;
+    pointer->highlighted_type = "";
+    SpatialHit hit;
+    if (spatial_query_connectors(spatial, nodes, world_x, world_y, CONNECTOR_PICK_RADIUS, &hit, 1) > 0) {
+        pointer->highlighted_node = hit.node + 1;
+        pointer->highlighted_connector = hit.connector + 1;
+        pointer->highlighted_type = hit.kind == SPATIAL_INPUT ? "input" : "output";
+    }
+
+    // Only hover changes, drags, pans and rubber-band connections need a new frame
+    bool redraw = pointer->is_dragging || pointer->is_panning || pointer->is_connecting ||
+                  pointer->highlighted_node != previous_node || pointer->highlighted_connector != previous_connector ||
+                  strcmp(pointer->highlighted_type, previous_type) != 0;
+
+    // Handle dragging
+    if (pointer->is_dragging) {
+        int dragged = node_store_index(nodes, pointer->dragged_node);
+        if (dragged >= 0) {
+            node_store_set_position(nodes, dragged, world_x - pointer->drag_offset_x, world_y - pointer->drag_offset_y);
+            spatial_update_node(spatial, nodes, dragged);
+        }
+    }
+    // Handle panning; the deltas of skipped events add up to this one
+    else if (pointer->is_panning) {
+        float delta_x = (pointer->mouse_x - pointer->pan_start_x) / cam_scale;
+        float delta_y = (pointer->mouse_y - pointer->pan_start_y) / cam_scale;
+        camera->x = cam_x - delta_x;
+        camera->y = cam_y - delta_y;
+        camera->dirty = true;
+        pointer->pan_start_x = pointer->mouse_x;
+        pointer->pan_start_y = pointer->mouse_y;
+    }
+    return redraw;
+}
+
+// Headless: evaluate the script's graph `passes` times without opening a window and
+// report throughput in node evaluations per second, then make `passes` single-value edits
+// and report how much of the graph each incremental update re-ran
+static int run_eval(const char *script_path, int passes) {
+    lua_State *L = lua_utils_init(script_path);
+    if (!L) {
+        return 1;
+    }
+    log_set_all_levels(log_level_from_string(lua_utils_get_string(L, "config", "log_level", "info"), LOG_LEVEL_INFO));
+    lua_utils_gc_automatic(L); // no frames here to run the per-frame GC budget in
+    NodeStore nodes;
+    node_store_init(&nodes);
+    EvalGraph *graph = eval_create();
+    if (!graph || !node_store_load_lua(&nodes, L)) {
+        LOG_ERROR(LOG_CATEGORY_EVAL, "Failed to load the graph from '%s'", script_path);
+        eval_destroy(graph, L);
+        node_store_free(&nodes);
+        lua_utils_cleanup(L);
+        return 1;
+    }
+    node_store_bind_lua(&nodes, L);
+    eval_attach(graph, L, &nodes);
+    eval_compile(graph, L, &nodes); // cycles are logged; the acyclic part still runs
+
+    Uint64 start_ns = SDL_GetTicksNS();
+    long long evaluated = 0;
+    for (int pass = 0; pass < passes; pass++) {
+        evaluated += eval_run(graph, L, &nodes);
+    }
+    Uint64 elapsed_ns = SDL_GetTicksNS() - start_ns;
+    LOG_INFO(LOG_CATEGORY_EVAL, "%d passes over %d nodes: %lld evaluations in %.2f ms, %.0f evaluations/s",
+             passes, eval_scheduled_count(graph), evaluated, elapsed_ns / 1e6,
+             elapsed_ns > 0 ? evaluated * 1e9 / elapsed_ns : 0.0);
+
+    // Edit one node's value at a time, round robin, as a script or the editor would
+    long long rerun = 0, skipped = 0;
+    start_ns = SDL_GetTicksNS();
+    for (int edit = 0; edit < passes && nodes.count > 0; edit++) {
+        int index = edit % nodes.count;
+        nodes.value[index] += 1.0f;
+        node_store_notify(&nodes, index, false);
+        EvalStats stats;
+        eval_update(graph, L, &nodes, &stats);
+        rerun += stats.evaluated;
+        skipped += stats.skipped;
+    }
+    elapsed_ns = SDL_GetTicksNS() - start_ns;
+    if (nodes.count > 0) {
+        LOG_INFO(LOG_CATEGORY_EVAL, "%d edits: %.1f nodes re-run and %.1f skipped per edit, %.2f ms, %.0f evaluations/s",
+                 passes, (double)rerun / passes, (double)skipped / passes, elapsed_ns / 1e6,
+                 elapsed_ns > 0 ? rerun * 1e9 / elapsed_ns : 0.0);
+    }
+    for (int i = 0; i < nodes.count && LOG_ENABLED(LOG_CATEGORY_EVAL, LOG_LEVEL_DEBUG); i++) {
+        for (int j = 0; j < nodes.outputs[i]; j++) {
+            LOG_DEBUG(LOG_CATEGORY_EVAL, "Node %d '%s' output %d = %g", nodes.id[i], node_store_text(&nodes, i),
+                      j + 1, eval_output(graph, i, j));
+        }
+    }
+    eval_destroy(graph, L);
+    node_store_free(&nodes);
+    lua_utils_cleanup(L);
+    return 0;
+}
+
 int main(int argc, char *argv[]) {
+    const char *script_path = "script.lua";
+    // --eval N: headless evaluation benchmark
+    for (int i = 1; i + 1 < argc; i++) {
+        if (SDL_strcmp(argv[i], "--eval") == 0) {
+            int passes = SDL_atoi(argv[i + 1]);
+            return run_eval(script_path, passes > 0 ? passes : 1);
+        }
+    }
+
     // Initialize SDL3
-    if (SDL_Init(SDL_INIT_VIDEO) < 0) {
-        SDL_Log("SDL_Init failed: %s", SDL_GetError());
+    if (!SDL_Init(SDL_INIT_VIDEO)) {
+        LOG_ERROR(LOG_CATEGORY_GENERAL, "SDL_Init failed: %s", SDL_GetError());
         return 1;
     }
 
+    // Start the background log writer; messages logged before this are written synchronously
+    if (!log_init()) {
+        LOG_WARN(LOG_CATEGORY_GENERAL, "Logging falls back to synchronous writes");
+    }
+
     // Initialize SDL_ttf
     if (TTF_Init() == 0) {
-        SDL_Log("TTF_Init failed: %s", SDL_GetError());
+        LOG_ERROR(LOG_CATEGORY_GENERAL, "TTF_Init failed: %s", SDL_GetError());
+        log_shutdown();
         SDL_Quit();
         return 1;
     }
 
     // Initialize Lua
-    lua_State *L = lua_utils_init("script.lua");
+    lua_State *L = lua_utils_init(script_path);
     if (!L) {
         TTF_Quit();
+        log_shutdown();
         SDL_Quit();
         return 1;
     }
 
+    // Runtime log level (compile-time floor is LOG_COMPILE_LEVEL)
+    log_set_all_levels(log_level_from_string(lua_utils_get_string(L, "config", "log_level", "info"), LOG_LEVEL_INFO));
+
     // Get window configuration
     const char *window_title = lua_utils_get_string(L, "config", "window_title", "SDL3 Lua App");
     int window_width = lua_utils_get_integer(L, "config", "window_width", 800);
@@ -41,9 +207,10 @@ int main(int argc, char *argv[]) {
         SDL_WINDOW_OPENGL | SDL_WINDOW_RESIZABLE
     );
     if (!window) {
-        SDL_Log("SDL_CreateWindow failed: %s", SDL_GetError());
+        LOG_ERROR(LOG_CATEGORY_GENERAL, "SDL_CreateWindow failed: %s", SDL_GetError());
         lua_utils_cleanup(L);
         TTF_Quit();
+        log_shutdown();
         SDL_Quit();
         return 1;
     }
@@ -54,6 +221,7 @@ int main(int argc, char *argv[]) {
         SDL_DestroyWindow(window);
         lua_utils_cleanup(L);
         TTF_Quit();
+        log_shutdown();
         SDL_Quit();
         return 1;
     }
@@ -63,435 +231,501 @@ int main(int argc, char *argv[]) {
     int font_size = lua_utils_get_integer(L, "config", "font_size", 24);
     TTF_Font *font = TTF_OpenFont(font_path, font_size);
     if (!font) {
-        SDL_Log("TTF_OpenFont failed: %s", SDL_GetError());
-        SDL_GL_DestroyContext(gl_context);
+        LOG_ERROR(LOG_CATEGORY_GENERAL, "TTF_OpenFont failed: %s", SDL_GetError());
+        cleanup_opengl_context(gl_context);
         SDL_DestroyWindow(window);
         lua_utils_cleanup(L);
         TTF_Quit();
+        log_shutdown();
         SDL_Quit();
         return 1;
     }
 
-    // Dragging, panning, and connection state
-    bool is_dragging = false;
-    bool is_panning = false;
-    bool is_connecting = false;
-    float drag_offset_x = 0.0f;
-    float drag_offset_y = 0.0f;
-    int dragged_node_index = 0; // 1-based index of dragged node
-    float pan_start_x = 0.0f;
-    float pan_start_y = 0.0f;
-    int from_node = 0, from_output = 0; // Connection start
-    float mouse_x = 0.0f, mouse_y = 0.0f; // For connection line
-    int highlighted_node = 0, highlighted_connector = 0; // For hover
-    const char *highlighted_type = "";
+    // Level of detail thresholds (camera scale below which a detail is dropped)
+    float lod_label_min_scale = lua_utils_get_number(L, "config", "lod_label_min_scale", 0.5f);
+    float lod_connector_min_scale = lua_utils_get_number(L, "config", "lod_connector_min_scale", 0.35f);
+    float lod_tile_max_scale = lua_utils_get_number(L, "config", "lod_tile_max_scale", 0.15f);
+    float lod_tile_size = lua_utils_get_number(L, "config", "lod_tile_size", 4.0f);
+
+    // Frame deadline that per-frame GC work must fit in
+    Uint64 frame_target_ns = (Uint64)(lua_utils_get_number(L, "config", "gc.frame_ms", 16.0f) * 1e6);
+
+    // Native node store, loaded once; scripts then reach it through the nodes proxy
+    NodeStore nodes;
+    node_store_init(&nodes);
+    if (!node_store_load_lua(&nodes, L)) {
+        LOG_ERROR(LOG_CATEGORY_GENERAL, "Failed to load nodes from script");
+        node_store_free(&nodes);
+        TTF_CloseFont(font);
+        cleanup_opengl_context(gl_context);
+        SDL_DestroyWindow(window);
+        lua_utils_cleanup(L);
+        TTF_Quit();
+        log_shutdown();
+        SDL_Quit();
+        return 1;
+    }
+
+    // What the file declared, so a reload can tell script edits from editor edits
+    ScriptSnapshot script_baseline;
+    if (!script_snapshot_take(L, &script_baseline)) {
+        LOG_WARN(LOG_CATEGORY_LUA, "Reloads will replace nodes instead of diffing them");
+    }
+    node_store_bind_lua(&nodes, L);
+
+    // Saving the script wakes the loop with reload_event; the reload happens after the event batch
+    Uint32 reload_event = 0;
+    FileWatch *script_watch = NULL;
+    if (lua_utils_get_boolean(L, "config", "hot_reload", true)) {
+        reload_event = SDL_RegisterEvents(1);
+        script_watch = reload_event ? watch_start(script_path, reload_event) : NULL;
+    }
+    bool reload_pending = false;
+
+    // Hit tests go through a uniform grid over node bodies and connector centers
+    SpatialGrid *spatial = spatial_create(lua_utils_get_number(L, "config", "spatial_cell_size", 128.0f));
+    if (!spatial) {
+        LOG_ERROR(LOG_CATEGORY_GENERAL, "Failed to create spatial index");
+        script_snapshot_free(&script_baseline);
+        node_store_free(&nodes);
+        TTF_CloseFont(font);
+        cleanup_opengl_context(gl_context);
+        SDL_DestroyWindow(window);
+        lua_utils_cleanup(L);
+        TTF_Quit();
+        log_shutdown();
+        SDL_Quit();
+        return 1;
+    }
+    SpatialHit hits[32];
+
+    // Camera paths are compiled once; the Lua table is only read here and written per frame
+    LuaPath camera_x_path, camera_y_path, camera_scale_path;
+    lua_utils_path_compile(L, &camera_x_path, "config.camera.x");
+    lua_utils_path_compile(L, &camera_y_path, "config.camera.y");
+    lua_utils_path_compile(L, &camera_scale_path, "config.camera.scale");
+    Camera camera = {
+        lua_utils_path_get_number(L, &camera_x_path, 0.0f),
+        lua_utils_path_get_number(L, &camera_y_path, 0.0f),
+        lua_utils_path_get_number(L, &camera_scale_path, 1.0f),
+        false
+    };
+
+    // Dragging, panning, connection and hover state
+    PointerState pointer = { 0 };
+    pointer.highlighted_type = "";
 
     // Main loop
     SDL_Event event;
     bool running = true;
+    bool needs_redraw = true; // Set by anything that changes what is on screen
+    Uint64 last_frame_ns = 0;
     while (running) {
-        while (SDL_PollEvent(&event)) {
+        // Block in SDL_WaitEvent while idle; only poll when a frame is pending or Lua animates
+        if (lua_utils_redraw_requested(L)) {
+            needs_redraw = true;
+        }
+        if (lua_utils_nodes_replaced(L)) {
+            // A script assigned a fresh nodes table: reload it and hand scripts a new proxy
+            pointer.is_dragging = pointer.is_connecting = false;
+            pointer.dragged_node = pointer.from_node = NODE_HANDLE_NONE;
+            pointer.from_output = 0;
+            pointer.highlighted_node = pointer.highlighted_connector = 0;
+            node_store_load_lua(&nodes, L);
+            node_store_bind_lua(&nodes, L);
+            needs_redraw = true;
+        }
+        spatial_sync(spatial, &nodes); // picks up geometry scripts and reloads changed
+        bool has_event = needs_redraw ? SDL_PollEvent(&event) : SDL_WaitEvent(&event);
+        for (; has_event; has_event = SDL_PollEvent(&event)) {
+            // Clicks and zoom act where the pointer is now, so pending motion lands first
+            if (pointer.motion_events > 0 && (event.type == SDL_EVENT_MOUSE_BUTTON_DOWN ||
+                event.type == SDL_EVENT_MOUSE_BUTTON_UP || event.type == SDL_EVENT_MOUSE_WHEEL ||
+                event.type == SDL_EVENT_KEY_DOWN)) {
+                needs_redraw |= apply_pointer_motion(&pointer, &camera, &nodes, spatial);
+            }
             if (event.type == SDL_EVENT_QUIT) {
                 running = false;
             }
+            else if (event.type == SDL_EVENT_WINDOW_RESIZED) {
+                render_resize(event.window.data1, event.window.data2);
+                needs_redraw = true;
+            }
+            else if (event.type == SDL_EVENT_WINDOW_EXPOSED) {
+                needs_redraw = true;
+            }
+            else if (reload_event && event.type == reload_event) {
+                reload_pending = true;
+            }
             else if (event.type == SDL_EVENT_MOUSE_BUTTON_DOWN && event.button.button == SDL_BUTTON_LEFT) {
+                needs_redraw = true;
                 // Get camera properties
-                float cam_x = lua_utils_get_number(L, "config", "camera.x", 0.0f);
-                float cam_y = lua_utils_get_number(L, "config", "camera.y", 0.0f);
-                float cam_scale = lua_utils_get_number(L, "config", "camera.scale", 1.0f);
+                float cam_x = camera.x;
+                float cam_y = camera.y;
+                float cam_scale = camera.scale;
 
                 // Transform mouse coordinates to world space
-                int win_width, win_height;
-                SDL_GetWindowSize(window, &win_width, &win_height);
-                mouse_x = event.button.x;
-                mouse_y = event.button.y;
-                float world_x = mouse_x / cam_scale + cam_x;
-                float world_y = mouse_y / cam_scale + cam_y;
-
-                // Check for connector click (for connection)
-                int node_count = lua_utils_get_nodes_count(L);
-                bool connector_clicked = false;
-                for (int i = 1; i <= node_count && !connector_clicked; i++) {
-                    float node_x = lua_utils_get_node_number(L, i, "x", 400.0f);
-                    float node_y = lua_utils_get_node_number(L, i, "y", 300.0f);
-                    float node_size = lua_utils_get_node_number(L, i, "size", 100.0f);
-                    int inputs = lua_utils_get_node_connectors(L, i, "inputs", 0);
-                    int outputs = lua_utils_get_node_connectors(L, i, "outputs", 0);
-                    float half_size = node_size / 2.0f;
-                    float connector_spacing = 20.0f;
-                    const float detect_radius = 15.0f;
-
-                    // Check outputs
-                    for (int j = 0; j < outputs && !connector_clicked; j++) {
-                        float conn_y = node_y + (j * connector_spacing) - (outputs - 1) * connector_spacing / 2.0f;
-                        float conn_x = node_x + half_size;
-                        float dx = world_x - conn_x;
-                        float dy = world_y - conn_y;
-                        if (sqrtf(dx * dx + dy * dy) <= detect_radius) {
-                            is_connecting = true;
-                            from_node = i;
-                            from_output = j + 1;
-                            connector_clicked = true;
-                            SDL_Log("Connection started: from_node=%d, from_output=%d at (%.1f, %.1f)", i, j+1, conn_x, conn_y);
-                        }
-                    }
-
-                    // Check inputs (only if not starting a connection)
-                    if (!is_connecting) {
-                        for (int j = 0; j < inputs && !connector_clicked; j++) {
-                            float conn_y = node_y + (j * connector_spacing) - (inputs - 1) * connector_spacing / 2.0f;
-                            float conn_x = node_x - half_size;
-                            float dx = world_x - conn_x;
-                            float dy = world_y - conn_y;
-                            if (sqrtf(dx * dx + dy * dy) <= detect_radius) {
-                                // Not used for starting connection
-                                connector_clicked = true;
-                            }
-                        }
+                pointer.mouse_x = event.button.x;
+                pointer.mouse_y = event.button.y;
+                float world_x = pointer.mouse_x / cam_scale + cam_x;
+                float world_y = pointer.mouse_y / cam_scale + cam_y;
+
+                // Check for connector click: the lowest node under the pointer wins; its outputs
+                // start a connection, an input only keeps the click from starting a drag
+                int node_count = nodes.count;
+                int hit_count = spatial_query_connectors(spatial, &nodes, world_x, world_y, CONNECTOR_PICK_RADIUS, hits, SDL_arraysize(hits));
+                bool connector_clicked = hit_count > 0;
+                for (int h = 0; h < hit_count && hits[h].node == hits[0].node; h++) {
+                    if (hits[h].kind == SPATIAL_OUTPUT) {
+                        pointer.is_connecting = true;
+                        pointer.from_node = node_store_handle(&nodes, hits[h].node);
+                        pointer.from_output = hits[h].connector + 1;
+                        LOG_DEBUG(LOG_CATEGORY_INPUT, "Connection started: from_node=%d, from_output=%d", nodes.id[hits[h].node], pointer.from_output);
+                        break;
                     }
                 }
 
                 // Check nodes for dragging (if no connector clicked)
                 if (!connector_clicked) {
-                    for (int i = 1; i <= node_count; i++) {
-                        float node_x = lua_utils_get_node_number(L, i, "x", 400.0f);
-                        float node_y = lua_utils_get_node_number(L, i, "y", 300.0f);
-                        float node_size = lua_utils_get_node_number(L, i, "size", 100.0f);
-                        const char* node_text = lua_utils_get_node_text(L, i, "");
-                        float half_size = node_size / 2.0f;
-                        if (world_x >= node_x - half_size && world_x <= node_x + half_size &&
-                            world_y >= node_y - half_size && world_y <= node_y + half_size) {
-                            dragged_node_index = i;
-                            drag_offset_x = world_x - node_x;
-                            drag_offset_y = world_y - node_y;
-                            is_dragging = true;
-                            SDL_Log("Dragging started: node=%d, text='%s', mouse=(%.1f, %.1f), world=(%.1f, %.1f), node=(%.1f, %.1f), bounds=[%.1f, %.1f]x[%.1f, %.1f], cam=(%.1f, %.1f, %.2f)",
-                                    i, node_text, mouse_x, mouse_y, world_x, world_y, node_x, node_y,
-                                    node_x - half_size, node_x + half_size, node_y - half_size, node_y + half_size,
-                                    cam_x, cam_y, cam_scale);
-                            break;
-                        }
+                    int body = spatial_query_body(spatial, &nodes, world_x, world_y);
+                    if (body >= 0) {
+                        float node_x = nodes.x[body];
+                        float node_y = nodes.y[body];
+                        float half_size = nodes.size[body] / 2.0f;
+                        pointer.dragged_node = node_store_handle(&nodes, body);
+                        pointer.drag_offset_x = world_x - node_x;
+                        pointer.drag_offset_y = world_y - node_y;
+                        pointer.is_dragging = true;
+                        LOG_DEBUG(LOG_CATEGORY_INPUT, "Dragging started: node=%d, text='%s', mouse=(%.1f, %.1f), world=(%.1f, %.1f), node=(%.1f, %.1f), bounds=[%.1f, %.1f]x[%.1f, %.1f], cam=(%.1f, %.1f, %.2f)",
+                                nodes.id[body], node_store_text(&nodes, body), pointer.mouse_x, pointer.mouse_y, world_x, world_y, node_x, node_y,
+                                node_x - half_size, node_x + half_size, node_y - half_size, node_y + half_size,
+                                cam_x, cam_y, cam_scale);
                     }
-                    if (!is_dragging && node_count > 0) {
-                        float node_x = lua_utils_get_node_number(L, 1, "x", 400.0f);
-                        float node_y = lua_utils_get_node_number(L, 1, "y", 300.0f);
-                        float node_size = lua_utils_get_node_number(L, 1, "size", 100.0f);
-                        const char* node_text = lua_utils_get_node_text(L, 1, "");
+                    if (!pointer.is_dragging && node_count > 0) {
+                        float node_x = nodes.x[0];
+                        float node_y = nodes.y[0];
+                        float node_size = nodes.size[0];
+                        const char* node_text = node_store_text(&nodes, 0);
                         float half_size = node_size / 2.0f;
-                        SDL_Log("Click outside nodes: mouse=(%.1f, %.1f), world=(%.1f, %.1f), node1=(%.1f, %.1f), text='%s', bounds=[%.1f, %.1f]x[%.1f, %.1f], cam=(%.1f, %.1f, %.2f)",
-                                mouse_x, mouse_y, world_x, world_y, node_x, node_y, node_text,
+                        LOG_DEBUG(LOG_CATEGORY_INPUT, "Click outside nodes: mouse=(%.1f, %.1f), world=(%.1f, %.1f), node1=(%.1f, %.1f), text='%s', bounds=[%.1f, %.1f]x[%.1f, %.1f], cam=(%.1f, %.1f, %.2f)",
+                                pointer.mouse_x, pointer.mouse_y, world_x, world_y, node_x, node_y, node_text,
                                 node_x - half_size, node_x + half_size, node_y - half_size, node_y + half_size,
                                 cam_x, cam_y, cam_scale);
                     }
                 }
             }
             else if (event.type == SDL_EVENT_MOUSE_BUTTON_UP && event.button.button == SDL_BUTTON_LEFT) {
-                if (is_connecting) {
+                needs_redraw = true;
+                if (pointer.is_connecting) {
                     // Check for input connector to complete connection
-                    float cam_x = lua_utils_get_number(L, "config", "camera.x", 0.0f);
-                    float cam_y = lua_utils_get_number(L, "config", "camera.y", 0.0f);
-                    float cam_scale = lua_utils_get_number(L, "config", "camera.scale", 1.0f);
-                    int win_width, win_height;
-                    SDL_GetWindowSize(window, &win_width, &win_height);
-                    mouse_x = event.button.x;
-                    mouse_y = event.button.y;
-                    float world_x = mouse_x / cam_scale + cam_x;
-                    float world_y = mouse_y / cam_scale + cam_y;
-
-                    int node_count = lua_utils_get_nodes_count(L);
-                    bool connected = false;
-                    for (int i = 1; i <= node_count && !connected; i++) {
-                        float node_x = lua_utils_get_node_number(L, i, "x", 400.0f);
-                        float node_y = lua_utils_get_node_number(L, i, "y", 300.0f);
-                        float node_size = lua_utils_get_node_number(L, i, "size", 100.0f);
-                        int inputs = lua_utils_get_node_connectors(L, i, "inputs", 0);
-                        float half_size = node_size / 2.0f;
-                        float connector_spacing = 20.0f;
-                        const float detect_radius = 15.0f;
-
-                        for (int j = 0; j < inputs && !connected; j++) {
-                            float conn_y = node_y + (j * connector_spacing) - (inputs - 1) * connector_spacing / 2.0f;
-                            float conn_x = node_x - half_size;
-                            float dx = world_x - conn_x;
-                            float dy = world_y - conn_y;
-                            if (sqrtf(dx * dx + dy * dy) <= detect_radius && i != from_node) {
-                                lua_utils_add_connection(L, from_node, from_output, i, j + 1);
-                                SDL_Log("Connection created: from_node=%d, from_output=%d to node=%d, to_input=%d", from_node, from_output, i, j+1);
-                                connected = true;
-                            }
+                    float cam_x = camera.x;
+                    float cam_y = camera.y;
+                    float cam_scale = camera.scale;
+                    pointer.mouse_x = event.button.x;
+                    pointer.mouse_y = event.button.y;
+                    float world_x = pointer.mouse_x / cam_scale + cam_x;
+                    float world_y = pointer.mouse_y / cam_scale + cam_y;
+
+                    // First input under the pointer, in node order, that is not on the source node
+                    int from_index = node_store_index(&nodes, pointer.from_node);
+                    int hit_count = from_index < 0 ? 0 : spatial_query_connectors(spatial, &nodes, world_x, world_y, CONNECTOR_PICK_RADIUS, hits, SDL_arraysize(hits));
+                    for (int h = 0; h < hit_count; h++) {
+                        if (hits[h].kind == SPATIAL_INPUT && hits[h].node != from_index) {
+                            int from_id = nodes.id[from_index], to_id = nodes.id[hits[h].node];
+                            lua_utils_add_connection(L, from_id, pointer.from_output, to_id, hits[h].connector + 1);
+                            LOG_DEBUG(LOG_CATEGORY_INPUT, "Connection created: from_node=%d, from_output=%d to node=%d, to_input=%d", from_id, pointer.from_output, to_id, hits[h].connector + 1);
+                            break;
                         }
                     }
-                    is_connecting = false;
-                    from_node = from_output = 0;
+                    pointer.is_connecting = false;
+                    pointer.from_node = NODE_HANDLE_NONE;
+                    pointer.from_output = 0;
                 }
-                is_dragging = false;
-                dragged_node_index = 0;
+                pointer.is_dragging = false;
+                pointer.dragged_node = NODE_HANDLE_NONE;
             }
             else if (event.type == SDL_EVENT_MOUSE_BUTTON_DOWN && event.button.button == SDL_BUTTON_RIGHT) {
+                needs_redraw = true;
                 // Remove connections near clicked connector
-                float cam_x = lua_utils_get_number(L, "config", "camera.x", 0.0f);
-                float cam_y = lua_utils_get_number(L, "config", "camera.y", 0.0f);
-                float cam_scale = lua_utils_get_number(L, "config", "camera.scale", 1.0f);
-                int win_width, win_height;
-                SDL_GetWindowSize(window, &win_width, &win_height);
-                mouse_x = event.button.x;
-                mouse_y = event.button.y;
-                float world_x = mouse_x / cam_scale + cam_x;
-                float world_y = mouse_y / cam_scale + cam_y;
-
-                int node_count = lua_utils_get_nodes_count(L);
-                for (int i = 1; i <= node_count; i++) {
-                    float node_x = lua_utils_get_node_number(L, i, "x", 400.0f);
-                    float node_y = lua_utils_get_node_number(L, i, "y", 300.0f);
-                    float node_size = lua_utils_get_node_number(L, i, "size", 100.0f);
-                    int inputs = lua_utils_get_node_connectors(L, i, "inputs", 0);
-                    int outputs = lua_utils_get_node_connectors(L, i, "outputs", 0);
-                    float half_size = node_size / 2.0f;
-                    float connector_spacing = 20.0f;
-                    const float detect_radius = 15.0f;
-
-                    // Check inputs
-                    for (int j = 0; j < inputs; j++) {
-                        float conn_y = node_y + (j * connector_spacing) - (inputs - 1) * connector_spacing / 2.0f;
-                        float conn_x = node_x - half_size;
-                        float dx = world_x - conn_x;
-                        float dy = world_y - conn_y;
-                        if (sqrtf(dx * dx + dy * dy) <= detect_radius) {
-                            lua_utils_remove_connections(L, i, "input", j + 1);
-                            SDL_Log("Removed connections for node=%d, input=%d at (%.1f, %.1f)", i, j+1, conn_x, conn_y);
-                        }
-                    }
-
-                    // Check outputs
-                    for (int j = 0; j < outputs; j++) {
-                        float conn_y = node_y + (j * connector_spacing) - (outputs - 1) * connector_spacing / 2.0f;
-                        float conn_x = node_x + half_size;
-                        float dx = world_x - conn_x;
-                        float dy = world_y - conn_y;
-                        if (sqrtf(dx * dx + dy * dy) <= detect_radius) {
-                            lua_utils_remove_connections(L, i, "output", j + 1);
-                            SDL_Log("Removed connections for node=%d, output=%d at (%.1f, %.1f)", i, j+1, conn_x, conn_y);
-                        }
-                    }
+                float cam_x = camera.x;
+                float cam_y = camera.y;
+                float cam_scale = camera.scale;
+                pointer.mouse_x = event.button.x;
+                pointer.mouse_y = event.button.y;
+                float world_x = pointer.mouse_x / cam_scale + cam_x;
+                float world_y = pointer.mouse_y / cam_scale + cam_y;
+
+                int hit_count = spatial_query_connectors(spatial, &nodes, world_x, world_y, CONNECTOR_PICK_RADIUS, hits, SDL_arraysize(hits));
+                for (int h = 0; h < hit_count; h++) {
+                    bool input = hits[h].kind == SPATIAL_INPUT;
+                    lua_utils_remove_connections(L, nodes.id[hits[h].node], input ? "input" : "output", hits[h].connector + 1);
+                    LOG_DEBUG(LOG_CATEGORY_INPUT, "Removed connections for node=%d, %s=%d", nodes.id[hits[h].node], input ? "input" : "output", hits[h].connector + 1);
                 }
             }
             else if (event.type == SDL_EVENT_MOUSE_BUTTON_DOWN && event.button.button == SDL_BUTTON_MIDDLE) {
-                is_panning = true;
-                pan_start_x = event.button.x;
-                pan_start_y = event.button.y;
+                needs_redraw = true;
+                pointer.is_panning = true;
+                pointer.pan_start_x = event.button.x;
+                pointer.pan_start_y = event.button.y;
             }
             else if (event.type == SDL_EVENT_MOUSE_BUTTON_UP && event.button.button == SDL_BUTTON_MIDDLE) {
-                is_panning = false;
+                needs_redraw = true;
+                pointer.is_panning = false;
             }
-            else if (event.type == SDL_EVENT_MOUSE_MOTION) {
-                // Update mouse position
-                float cam_x = lua_utils_get_number(L, "config", "camera.x", 0.0f);
-                float cam_y = lua_utils_get_number(L, "config", "camera.y", 0.0f);
-                float cam_scale = lua_utils_get_number(L, "config", "camera.scale", 1.0f);
-                int win_width, win_height;
-                SDL_GetWindowSize(window, &win_width, &win_height);
-                mouse_x = event.motion.x;
-                mouse_y = event.motion.y;
-                float world_x = mouse_x / cam_scale + cam_x;
-                float world_y = mouse_y / cam_scale + cam_y;
-
-                // Check for connector hover
-                highlighted_node = 0;
-                highlighted_connector = 0;
-                highlighted_type = "";
-                int node_count = lua_utils_get_nodes_count(L);
-                for (int i = 1; i <= node_count && !highlighted_node; i++) {
-                    float node_x = lua_utils_get_node_number(L, i, "x", 400.0f);
-                    float node_y = lua_utils_get_node_number(L, i, "y", 300.0f);
-                    float node_size = lua_utils_get_node_number(L, i, "size", 100.0f);
-                    int inputs = lua_utils_get_node_connectors(L, i, "inputs", 0);
-                    int outputs = lua_utils_get_node_connectors(L, i, "outputs", 0);
-                    float half_size = node_size / 2.0f;
-                    float connector_spacing = 20.0f;
-                    const float detect_radius = 15.0f;
-
-                    // Check inputs
-                    for (int j = 0; j < inputs && !highlighted_node; j++) {
-                        float conn_y = node_y + (j * connector_spacing) - (inputs - 1) * connector_spacing / 2.0f;
-                        float conn_x = node_x - half_size;
-                        float dx = world_x - conn_x;
-                        float dy = world_y - conn_y;
-                        if (sqrtf(dx * dx + dy * dy) <= detect_radius) {
-                            highlighted_node = i;
-                            highlighted_connector = j + 1;
-                            highlighted_type = "input";
-                        }
-                    }
-
-                    // Check outputs
-                    for (int j = 0; j < outputs && !highlighted_node; j++) {
-                        float conn_y = node_y + (j * connector_spacing) - (outputs - 1) * connector_spacing / 2.0f;
-                        float conn_x = node_x + half_size;
-                        float dx = world_x - conn_x;
-                        float dy = world_y - conn_y;
-                        if (sqrtf(dx * dx + dy * dy) <= detect_radius) {
-                            highlighted_node = i;
-                            highlighted_connector = j + 1;
-                            highlighted_type = "output";
-                        }
-                    }
+            else if (event.type == SDL_EVENT_KEY_DOWN &&
+                     (event.key.key == SDLK_DELETE || event.key.key == SDLK_BACKSPACE)) {
+                // Delete the dragged node, or else the one under the pointer, with its connections
+                int index = node_store_index(&nodes, pointer.dragged_node);
+                if (index < 0) {
+                    index = spatial_query_body(spatial, &nodes, pointer.mouse_x / camera.scale + camera.x,
+                                               pointer.mouse_y / camera.scale + camera.y);
                 }
-
-                // Handle dragging
-                if (is_dragging) {
-                    world_x = mouse_x / cam_scale + cam_x;
-                    world_y = mouse_y / cam_scale + cam_y;
-                    if (dragged_node_index > 0) {
-                        lua_utils_set_node_number(L, dragged_node_index, "x", world_x - drag_offset_x);
-                        lua_utils_set_node_number(L, dragged_node_index, "y", world_y - drag_offset_y);
+                if (index >= 0) {
+                    int id = nodes.id[index];
+                    LOG_DEBUG(LOG_CATEGORY_INPUT, "Deleting node=%d, text='%s'", id, node_store_text(&nodes, index));
+                    lua_utils_remove_node_connections(L, id);
+                    int moved_from = node_store_remove(&nodes, index);
+                    spatial_remove_node(spatial, &nodes, index, moved_from);
+                    pointer.is_dragging = false;
+                    pointer.dragged_node = NODE_HANDLE_NONE;
+                    if (node_store_index(&nodes, pointer.from_node) < 0) {
+                        pointer.is_connecting = false;
+                        pointer.from_node = NODE_HANDLE_NONE;
+                        pointer.from_output = 0;
                     }
-                }
-                // Handle panning
-                else if (is_panning) {
-                    float delta_x = (event.motion.x - pan_start_x) / cam_scale;
-                    float delta_y = (event.motion.y - pan_start_y) / cam_scale;
-                    lua_utils_set_number(L, "config", "camera.x", cam_x - delta_x);
-                    lua_utils_set_number(L, "config", "camera.y", cam_y - delta_y);
-                    pan_start_x = event.motion.x;
-                    pan_start_y = event.motion.y;
+                    pointer.highlighted_node = pointer.highlighted_connector = 0;
+                    pointer.highlighted_type = "";
+                    needs_redraw = true;
                 }
             }
+            else if (event.type == SDL_EVENT_MOUSE_MOTION) {
+                // Only the latest position matters; it is applied once per frame below
+                pointer.mouse_x = event.motion.x;
+                pointer.mouse_y = event.motion.y;
+                pointer.motion_events++;
+            }
             else if (event.type == SDL_EVENT_MOUSE_WHEEL) {
+                needs_redraw = true;
                 // Get mouse position and current camera properties
-                int win_width, win_height;
-                SDL_GetWindowSize(window, &win_width, &win_height);
-                float cam_x = lua_utils_get_number(L, "config", "camera.x", 0.0f);
-                float cam_y = lua_utils_get_number(L, "config", "camera.y", 0.0f);
-                float cam_scale = lua_utils_get_number(L, "config", "camera.scale", 1.0f);
+                float cam_x = camera.x;
+                float cam_y = camera.y;
+                float cam_scale = camera.scale;
 
                 // Zoom
                 float zoom_factor = event.wheel.y > 0 ? 1.1f : 0.9f;
                 float new_scale = cam_scale * zoom_factor;
 
                 // Adjust camera position to zoom towards mouse
-                float world_x_before = mouse_x / cam_scale + cam_x;
-                float world_y_before = mouse_y / cam_scale + cam_y;
-                float world_x_after = mouse_x / new_scale + cam_x;
-                float world_y_after = mouse_y / new_scale + cam_y;
+                float world_x_before = pointer.mouse_x / cam_scale + cam_x;
+                float world_y_before = pointer.mouse_y / cam_scale + cam_y;
+                float world_x_after = pointer.mouse_x / new_scale + cam_x;
+                float world_y_after = pointer.mouse_y / new_scale + cam_y;
                 float new_cam_x = cam_x + (world_x_before - world_x_after);
                 float new_cam_y = cam_y + (world_y_before - world_y_after);
 
                 // Update camera
-                lua_utils_set_number(L, "config", "camera.x", new_cam_x);
-                lua_utils_set_number(L, "config", "camera.y", new_cam_y);
-                lua_utils_set_number(L, "config", "camera.scale", new_scale);
+                camera.x = new_cam_x;
+                camera.y = new_cam_y;
+                camera.scale = new_scale;
+                camera.dirty = true;
+            }
+        }
+
+        if (pointer.motion_events > 0) {
+            needs_redraw |= apply_pointer_motion(&pointer, &camera, &nodes, spatial);
+        }
+
+        if (reload_pending && running) {
+            reload_pending = false;
+            if (script_reload(L, &nodes, script_path, &script_baseline)) {
+                // Camera and interaction state are kept; only references to removed nodes are dropped
+                if (node_store_index(&nodes, pointer.dragged_node) < 0) {
+                    pointer.is_dragging = false;
+                    pointer.dragged_node = NODE_HANDLE_NONE;
+                }
+                if (node_store_index(&nodes, pointer.from_node) < 0) {
+                    pointer.is_connecting = false;
+                    pointer.from_node = NODE_HANDLE_NONE;
+                    pointer.from_output = 0;
+                }
+                // Removals move nodes between indices; hover is recomputed on the next motion
+                pointer.highlighted_node = pointer.highlighted_connector = 0;
+                pointer.highlighted_type = "";
+                log_set_all_levels(log_level_from_string(lua_utils_get_string(L, "config", "log_level", "info"), LOG_LEVEL_INFO));
+                SDL_SetWindowTitle(window, lua_utils_get_string(L, "config", "window_title", "SDL3 Lua App"));
+                lod_label_min_scale = lua_utils_get_number(L, "config", "lod_label_min_scale", 0.5f);
+                lod_connector_min_scale = lua_utils_get_number(L, "config", "lod_connector_min_scale", 0.35f);
+                lod_tile_max_scale = lua_utils_get_number(L, "config", "lod_tile_max_scale", 0.15f);
+                lod_tile_size = lua_utils_get_number(L, "config", "lod_tile_size", 4.0f);
+                frame_target_ns = (Uint64)(lua_utils_get_number(L, "config", "gc.frame_ms", 16.0f) * 1e6);
+                lua_utils_configure_gc(L);
+                needs_redraw = true;
             }
         }
 
+        if (!running || !needs_redraw) {
+            continue;
+        }
+        needs_redraw = false;
+        Uint64 frame_start_ns = SDL_GetTicksNS();
+
+        // Script hook; calling request_redraw() or editing nodes from it schedules the next frame
+        lua_utils_run_frame(L, last_frame_ns ? (frame_start_ns - last_frame_ns) / 1e9 : 0.0);
+        last_frame_ns = frame_start_ns;
+
         // Clear screen
         glClear(GL_COLOR_BUFFER_BIT);
 
-        // Get camera properties
-        float cam_x = lua_utils_get_number(L, "config", "camera.x", 0.0f);
-        float cam_y = lua_utils_get_number(L, "config", "camera.y", 0.0f);
-        float cam_scale = lua_utils_get_number(L, "config", "camera.scale", 1.0f);
+        // Get camera properties and mirror them into config.camera for scripts
+        float cam_x = camera.x;
+        float cam_y = camera.y;
+        float cam_scale = camera.scale;
+        if (camera.dirty) {
+            lua_utils_path_set_number(L, &camera_x_path, cam_x);
+            lua_utils_path_set_number(L, &camera_y_path, cam_y);
+            lua_utils_path_set_number(L, &camera_scale_path, cam_scale);
+            camera.dirty = false;
+        }
+
+        render_begin_frame(cam_x, cam_y, cam_scale);
+        bool lod_labels = cam_scale >= lod_label_min_scale;
+        bool lod_connectors = cam_scale >= lod_connector_min_scale;
+        bool lod_tiles = cam_scale < lod_tile_max_scale;
 
         // Render connections (before nodes for layering)
-        int conn_count = lua_utils_get_connections_count(L);
-        for (int i = 1; i <= conn_count; i++) {
-            int from_node, from_output, to_node, to_input;
-            lua_utils_get_connection(L, i, &from_node, &from_output, &to_node, &to_input);
-            if (from_node > 0 && to_node > 0) {
-                float from_x = lua_utils_get_node_number(L, from_node, "x", 400.0f);
-                float from_y = lua_utils_get_node_number(L, from_node, "y", 300.0f);
-                float from_size = lua_utils_get_node_number(L, from_node, "size", 100.0f);
-                int from_outputs = lua_utils_get_node_connectors(L, from_node, "outputs", 0);
-                float to_x = lua_utils_get_node_number(L, to_node, "x", 400.0f);
-                float to_y = lua_utils_get_node_number(L, to_node, "y", 300.0f);
-                float to_size = lua_utils_get_node_number(L, to_node, "size", 100.0f);
-                int to_inputs = lua_utils_get_node_connectors(L, to_node, "inputs", 0);
-                float from_half = from_size / 2.0f;
-                float to_half = to_size / 2.0f;
-                float connector_spacing = 20.0f;
-                float x1 = from_x + from_half;
-                float y1 = from_y + (from_output - 1) * connector_spacing - (from_outputs - 1) * connector_spacing / 2.0f;
-                float x2 = to_x - to_half;
-                float y2 = to_y + (to_input - 1) * connector_spacing - (to_inputs - 1) * connector_spacing / 2.0f;
-                render_line(x1, y1, x2, y2, 1.0f, 0.0f, 1.0f, window, cam_x, cam_y, cam_scale);
+        int conn_count;
+        const LuaConnection *connections = lua_utils_get_connections(L, &conn_count);
+        for (int i = 0; i < conn_count; i++) {
+            // Endpoints are node ids; dangling ones (deleted or never declared) are skipped
+            int edge_from = node_store_find_id(&nodes, connections[i].from_node), edge_output = connections[i].from_output;
+            int edge_to = node_store_find_id(&nodes, connections[i].to_node), edge_input = connections[i].to_input;
+            if (edge_from >= 0 && edge_to >= 0) {
+                float x1, y1, x2, y2;
+                node_store_connector_position(&nodes, edge_from, true, edge_output - 1, &x1, &y1);
+                node_store_connector_position(&nodes, edge_to, false, edge_input - 1, &x2, &y2);
+                if (!lod_connectors) {
+                    // Connectors are collapsed: join the node edges at their centers
+                    y1 = nodes.y[edge_from];
+                    y2 = nodes.y[edge_to];
+                }
+                if (render_segment_visible(x1, y1, x2, y2)) {
+                    render_line(x1, y1, x2, y2, 1.0f, 0.0f, 1.0f);
+                }
             }
         }
 
         // Render temporary connection line
-        if (is_connecting) {
-            float from_x = lua_utils_get_node_number(L, from_node, "x", 400.0f);
-            float from_y = lua_utils_get_node_number(L, from_node, "y", 300.0f);
-            float from_size = lua_utils_get_node_number(L, from_node, "size", 100.0f);
-            int from_outputs = lua_utils_get_node_connectors(L, from_node, "outputs", 0);
-            float from_half = from_size / 2.0f;
-            float connector_spacing = 20.0f;
-            float x1 = from_x + from_half;
-            float y1 = from_y + (from_output - 1) * connector_spacing - (from_outputs - 1) * connector_spacing / 2.0f;
-            float x2 = mouse_x / cam_scale + cam_x;
-            float y2 = mouse_y / cam_scale + cam_y;
-            render_line(x1, y1, x2, y2, 1.0f, 0.0f, 1.0f, window, cam_x, cam_y, cam_scale);
+        int connecting_node = pointer.is_connecting ? node_store_index(&nodes, pointer.from_node) : -1;
+        if (connecting_node >= 0) {
+            float x1, y1;
+            node_store_connector_position(&nodes, connecting_node, true, pointer.from_output - 1, &x1, &y1);
+            float x2 = pointer.mouse_x / cam_scale + cam_x;
+            float y2 = pointer.mouse_y / cam_scale + cam_y;
+            render_line(x1, y1, x2, y2, 1.0f, 0.0f, 1.0f);
         }
 
-        // Render nodes
-        int node_count = lua_utils_get_nodes_count(L);
-        for (int i = 1; i <= node_count; i++) {
-            float node_x = lua_utils_get_node_number(L, i, "x", 400.0f);
-            float node_y = lua_utils_get_node_number(L, i, "y", 300.0f);
-            float node_size = lua_utils_get_node_number(L, i, "size", 100.0f);
-            float node_r = lua_utils_get_node_number(L, i, "r", 1.0f);
-            float node_g = lua_utils_get_node_number(L, i, "g", 0.0f);
-            float node_b = lua_utils_get_node_number(L, i, "b", 0.0f);
-            const char* node_text = lua_utils_get_node_text(L, i, "");
-            int inputs = lua_utils_get_node_connectors(L, i, "inputs", 0);
-            int outputs = lua_utils_get_node_connectors(L, i, "outputs", 0);
+        // Render nodes and connectors as instances (one draw call per kind on flush). All bodies
+        // draw before all connectors, so a connector stays visible over an overlapping node.
+        int node_count = nodes.count;
+        if (lod_tiles) {
+            // Far zoom: nodes only contribute to aggregated screen tiles
+            render_tiles_begin(lod_tile_size);
+            for (int i = 1; i <= node_count; i++) {
+                float node_x = nodes.x[i - 1];
+                float node_y = nodes.y[i - 1];
+                float half_size = nodes.size[i - 1] / 2.0f;
+                if (!render_rect_visible(node_x - half_size, node_y - half_size, node_x + half_size, node_y + half_size)) {
+                    continue;
+                }
+                render_tiles_mark(node_x - half_size, node_y - half_size, node_x + half_size, node_y + half_size,
+                                  nodes.r[i - 1], nodes.g[i - 1], nodes.b[i - 1]);
+            }
+            render_tiles_end();
+        }
+        for (int i = 1; i <= node_count && !lod_tiles; i++) {
+            float node_x = nodes.x[i - 1];
+            float node_y = nodes.y[i - 1];
+            float node_size = nodes.size[i - 1];
+            int inputs = nodes.inputs[i - 1];
+            int outputs = nodes.outputs[i - 1];
+            float half_size = node_size / 2.0f;
+            float connector_radius = 10.0f;
+
+            // Skip nodes whose body and connector column are both off screen
+            int ports = inputs > outputs ? inputs : outputs;
+            float reach_x = half_size + connector_radius * 1.2f;
+            float reach_y = fmaxf(half_size, (ports - 1) * NODE_CONNECTOR_SPACING / 2.0f + connector_radius * 1.2f);
+            if (!render_rect_visible(node_x - reach_x, node_y - reach_y, node_x + reach_x, node_y + reach_y)) {
+                continue;
+            }
+            float node_r = nodes.r[i - 1];
+            float node_g = nodes.g[i - 1];
+            float node_b = nodes.b[i - 1];
 
             // Render square
-            render_square(node_x, node_y, node_size, node_r, node_g, node_b, window, cam_x, cam_y, cam_scale);
+            render_push_node(node_x, node_y, node_size, 8.0f, node_r, node_g, node_b, 0);
 
             // Render connectors
-            float half_size = node_size / 2.0f;
-            float connector_spacing = 20.0f;
-            float connector_radius = 10.0f;
-            for (int j = 0; j < inputs; j++) {
-                float conn_y = node_y + (j * connector_spacing) - (inputs - 1) * connector_spacing / 2.0f;
-                float conn_x = node_x - half_size;
-                float r = 0.0f, g = 1.0f, b = 0.0f;
-                float radius = connector_radius;
-                if (highlighted_node == i && highlighted_connector == j+1 && strcmp(highlighted_type, "input") == 0) {
-                    radius *= 1.2f; // Highlight by increasing size
+            for (int j = 0; j < inputs && lod_connectors; j++) {
+                float conn_x, conn_y;
+                node_store_connector_position(&nodes, i - 1, false, j, &conn_x, &conn_y);
+                unsigned int flags = 0;
+                if (pointer.highlighted_node == i && pointer.highlighted_connector == j+1 && strcmp(pointer.highlighted_type, "input") == 0) {
+                    flags |= RENDER_INSTANCE_HIGHLIGHTED; // Highlight by increasing size
+                }
+                render_push_connector(conn_x, conn_y, connector_radius, 0.0f, 1.0f, 0.0f, flags);
+                if (flags & RENDER_INSTANCE_HIGHLIGHTED) {
+                    render_push_ring(conn_x, conn_y, connector_radius, 2.0f, 1.0f, 1.0f, 1.0f, flags);
                 }
-                render_circle(conn_x, conn_y, radius, r, g, b, window, cam_x, cam_y, cam_scale);
-                SDL_Log("Node %d input %d at (%.1f, %.1f)", i, j+1, conn_x, conn_y);
+                LOG_TRACE(LOG_CATEGORY_RENDER, "Node %d input %d at (%.1f, %.1f)", i, j+1, conn_x, conn_y);
             }
-            for (int j = 0; j < outputs; j++) {
-                float conn_y = node_y + (j * connector_spacing) - (outputs - 1) * connector_spacing / 2.0f;
-                float conn_x = node_x + half_size;
-                float r = 1.0f, g = 1.0f, b = 0.0f;
-                float radius = connector_radius;
-                if (highlighted_node == i && highlighted_connector == j+1 && strcmp(highlighted_type, "output") == 0) {
-                    radius *= 1.2f; // Highlight
+            for (int j = 0; j < outputs && lod_connectors; j++) {
+                float conn_x, conn_y;
+                node_store_connector_position(&nodes, i - 1, true, j, &conn_x, &conn_y);
+                unsigned int flags = 0;
+                if (pointer.highlighted_node == i && pointer.highlighted_connector == j+1 && strcmp(pointer.highlighted_type, "output") == 0) {
+                    flags |= RENDER_INSTANCE_HIGHLIGHTED; // Highlight
                 }
-                if (is_connecting && from_node == i && from_output == j+1) {
-                    radius *= 1.2f; // Highlight during connection
+                if (connecting_node == i - 1 && pointer.from_output == j+1) {
+                    flags |= RENDER_INSTANCE_SELECTED; // Highlight during connection, on top of hover
                 }
-                render_circle(conn_x, conn_y, radius, r, g, b, window, cam_x, cam_y, cam_scale);
-                SDL_Log("Node %d output %d at (%.1f, %.1f)", i, j+1, conn_x, conn_y);
+                render_push_connector(conn_x, conn_y, connector_radius, 1.0f, 1.0f, 0.0f, flags);
+                if (flags & (RENDER_INSTANCE_HIGHLIGHTED | RENDER_INSTANCE_SELECTED)) {
+                    render_push_ring(conn_x, conn_y, connector_radius, 2.0f, 1.0f, 1.0f, 1.0f, flags);
+                }
+                LOG_TRACE(LOG_CATEGORY_RENDER, "Node %d output %d at (%.1f, %.1f)", i, j+1, conn_x, conn_y);
             }
+        }
 
-            // Render node text
-            if (node_text[0] != '\0') {
-                int text_width, text_height;
-                if (TTF_GetStringSize(font, node_text, strlen(node_text), &text_width, &text_height)) {
-                    float text_x = node_x - text_width / 2.0f;
-                    float text_y = node_y - node_size / 2.0f - text_height - 10.0f;
-                    render_text(node_text, text_x, text_y, font, window, cam_x, cam_y, cam_scale);
-                    SDL_Log("Node %d text='%s', width=%d, height=%d, pos=(%.1f, %.1f)", i, node_text, text_width, text_height, text_x, text_y);
-                } else {
-                    SDL_Log("TTF_GetStringSize failed for text '%s': %s", node_text, SDL_GetError());
-                    float text_x = node_x - node_size / 4.0f;
-                    float text_y = node_y - node_size / 2.0f - 20.0f;
-                    render_text(node_text, text_x, text_y, font, window, cam_x, cam_y, cam_scale);
-                    SDL_Log("Node %d fallback text='%s', pos=(%.1f, %.1f)", i, node_text, text_x, text_y);
+        // Render node text (glyph quads from the atlas, drawn above all shapes on flush)
+        float view_min_x, view_min_y, view_max_x, view_max_y;
+        render_get_visible_rect(&view_min_x, &view_min_y, &view_max_x, &view_max_y);
+        for (int i = 1; i <= node_count && lod_labels; i++) {
+            float node_x = nodes.x[i - 1];
+            float node_y = nodes.y[i - 1];
+            float node_size = nodes.size[i - 1];
+            // Labels sit in a band above the node; skip rows outside the view before fetching the text
+            float label_top = node_y - node_size / 2.0f - font_size * 2.0f - 10.0f;
+            if (!render_rect_visible(view_min_x, label_top, view_max_x, node_y)) {
+                continue;
+            }
+            const char* node_text = node_store_text(&nodes, i - 1);
+            if (node_text[0] == '\0') continue;
+            int text_width, text_height;
+            if (render_measure_text(node_text, font, &text_width, &text_height)) {
+                float text_x = node_x - text_width / 2.0f;
+                float text_y = node_y - node_size / 2.0f - text_height - 10.0f;
+                if (!render_rect_visible(text_x, text_y, text_x + text_width, text_y + text_height)) {
+                    continue;
                 }
+                render_text(node_text, text_x, text_y, font);
+                LOG_TRACE(LOG_CATEGORY_RENDER, "Node %d text='%s', width=%d, height=%d, pos=(%.1f, %.1f)", i, node_text, text_width, text_height, text_x, text_y);
+            } else {
+                LOG_WARN(LOG_CATEGORY_RENDER, "render_measure_text failed for text '%s': %s", node_text, SDL_GetError());
+                float text_x = node_x - node_size / 4.0f;
+                float text_y = node_y - node_size / 2.0f - 20.0f;
+                render_text(node_text, text_x, text_y, font);
+                LOG_TRACE(LOG_CATEGORY_RENDER, "Node %d fallback text='%s', pos=(%.1f, %.1f)", i, node_text, text_x, text_y);
             }
         }
 
@@ -499,27 +733,53 @@ int main(int argc, char *argv[]) {
         const char *text = lua_utils_get_string(L, "config", "text", "Hello, World!");
         if (text[0] != '\0') {
             int text_width, text_height;
-            if (TTF_GetStringSize(font, text, strlen(text), &text_width, &text_height)) {
+            if (render_measure_text(text, font, &text_width, &text_height)) {
                 float text_x = 10.0f;
                 float text_y = 10.0f + text_height;
-                render_text(text, text_x, text_y, font, window, cam_x, cam_y, cam_scale);
-                SDL_Log("Global text='%s', width=%d, height=%d, pos=(%.1f, %.1f)", text, text_width, text_height, text_x, text_y);
+                if (render_rect_visible(text_x, text_y, text_x + text_width, text_y + text_height)) {
+                    render_text(text, text_x, text_y, font);
+                }
+                LOG_TRACE(LOG_CATEGORY_RENDER, "Global text='%s', width=%d, height=%d, pos=(%.1f, %.1f)", text, text_width, text_height, text_x, text_y);
             } else {
-                SDL_Log("TTF_GetStringSize failed for global text '%s': %s", text, SDL_GetError());
-                render_text(text, 10.0f, 10.0f, font, window, cam_x, cam_y, cam_scale);
-                SDL_Log("Global fallback text='%s', pos=(%.1f, %.1f)", text, 10.0f, 10.0f);
+                LOG_WARN(LOG_CATEGORY_RENDER, "render_measure_text failed for global text '%s': %s", text, SDL_GetError());
+                render_text(text, 10.0f, 10.0f, font);
+                LOG_TRACE(LOG_CATEGORY_RENDER, "Global fallback text='%s', pos=(%.1f, %.1f)", text, 10.0f, 10.0f);
             }
         }
 
+        render_flush();
+
+        // GC steps fill the time the GPU spends on the frame, bounded by the frame deadline
+        Uint64 frame_elapsed_ns = SDL_GetTicksNS() - frame_start_ns;
+        lua_utils_gc_step(L, frame_elapsed_ns < frame_target_ns ? frame_target_ns - frame_elapsed_ns : 0);
+
         SDL_GL_SwapWindow(window);
+        lua_utils_end_frame(L);
     }
 
     // Cleanup
+    watch_stop(script_watch);
+    spatial_destroy(spatial);
+    script_snapshot_free(&script_baseline);
+    AllocStats lua_memory;
+    lua_utils_memory_stats(L, &lua_memory);
+    LOG_INFO(LOG_CATEGORY_LUA, "Lua memory: live=%zu peak=%zu pooled=%zu allocations=%llu",
+             lua_memory.live_bytes, lua_memory.peak_bytes, lua_memory.pool_bytes, lua_memory.total_allocs);
+    if (camera.dirty) {
+        lua_utils_path_set_number(L, &camera_x_path, camera.x);
+        lua_utils_path_set_number(L, &camera_y_path, camera.y);
+        lua_utils_path_set_number(L, &camera_scale_path, camera.scale);
+    }
+    lua_utils_path_release(L, &camera_x_path);
+    lua_utils_path_release(L, &camera_y_path);
+    lua_utils_path_release(L, &camera_scale_path);
+    node_store_free(&nodes);
     TTF_CloseFont(font);
-    SDL_GL_DestroyContext(gl_context);
+    cleanup_opengl_context(gl_context);
     SDL_DestroyWindow(window);
     lua_utils_cleanup(L);
     TTF_Quit();
+    log_shutdown();
     SDL_Quit();
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,159 @@
+#include "module_alloc.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+enum {
+    ALLOC_PAGE_SIZE = 64 * 1024,
+    ALLOC_CLASS_COUNT = 12
+};
+
+// 16-byte steps up to 128, then 32-byte steps up to ALLOC_SMALL_MAX
+static const unsigned short class_sizes[ALLOC_CLASS_COUNT] = {
+    16, 32, 48, 64, 80, 96, 112, 128, 160, 192, 224, 256
+};
+
+typedef struct FreeBlock {
+    struct FreeBlock *next;
+} FreeBlock;
+
+// Pages are chained through their first bytes; blocks start after the padded header
+typedef struct AllocPage {
+    struct AllocPage *next;
+} AllocPage;
+#define ALLOC_PAGE_HEADER 16
+
+typedef struct {
+    FreeBlock *free_list;
+    char *bump;          // unused tail of the newest page for this class
+    char *bump_end;
+} SizeClass;
+
+struct AllocPool {
+    SizeClass classes[ALLOC_CLASS_COUNT];
+    AllocPage *pages;
+    AllocStats stats;
+    unsigned int current_frame_allocs;
+    size_t current_frame_bytes;
+};
+
+static int class_index(size_t size) {
+    if (size <= 128) return (int)((size + 15) / 16) - 1;
+    return 8 + (int)((size - 129) / 32);
+}
+
+AllocPool* alloc_pool_create(void) {
+    return calloc(1, sizeof(AllocPool));
+}
+
+void alloc_pool_destroy(AllocPool *pool) {
+    if (!pool) return;
+    AllocPage *page = pool->pages;
+    while (page) {
+        AllocPage *next = page->next;
+        free(page);
+        page = next;
+    }
+    free(pool);
+}
+
+static void* pool_alloc_small(AllocPool *pool, size_t size) {
+    SizeClass *size_class = &pool->classes[class_index(size)];
+    if (size_class->free_list) {
+        FreeBlock *block = size_class->free_list;
+        size_class->free_list = block->next;
+        return block;
+    }
+    size_t block_size = class_sizes[class_index(size)];
+    if (!size_class->bump || size_class->bump + block_size > size_class->bump_end) {
+        AllocPage *page = malloc(ALLOC_PAGE_SIZE);
+        if (!page) return NULL;
+        page->next = pool->pages;
+        pool->pages = page;
+        pool->stats.pool_bytes += ALLOC_PAGE_SIZE;
+        size_class->bump = (char*)page + ALLOC_PAGE_HEADER;
+        size_class->bump_end = (char*)page + ALLOC_PAGE_SIZE;
+    }
+    void *block = size_class->bump;
+    size_class->bump += block_size;
+    return block;
+}
+
+static void pool_free_small(AllocPool *pool, void *ptr, size_t size) {
+    SizeClass *size_class = &pool->classes[class_index(size)];
+    FreeBlock *block = ptr;
+    block->next = size_class->free_list;
+    size_class->free_list = block;
+}
+
+static void* pool_alloc(AllocPool *pool, size_t size) {
+    return size <= ALLOC_SMALL_MAX ? pool_alloc_small(pool, size) : malloc(size);
+}
+
+static void pool_free(AllocPool *pool, void *ptr, size_t size) {
+    if (size <= ALLOC_SMALL_MAX) {
+        pool_free_small(pool, ptr, size);
+    } else {
+        free(ptr);
+    }
+}
+
+static void count_allocation(AllocPool *pool, size_t old_size, size_t new_size) {
+    AllocStats *stats = &pool->stats;
+    stats->live_bytes = stats->live_bytes - old_size + new_size;
+    if (stats->live_bytes > stats->peak_bytes) {
+        stats->peak_bytes = stats->live_bytes;
+    }
+    if (new_size > old_size) {
+        stats->total_allocs++;
+        pool->current_frame_allocs++;
+        pool->current_frame_bytes += new_size - old_size;
+    }
+}
+
+void* alloc_pool_lua_alloc(void *ud, void *ptr, size_t osize, size_t nsize) {
+    AllocPool *pool = ud;
+    if (!ptr) {
+        osize = 0; // Lua passes the object type here for new blocks
+    }
+    if (nsize == 0) {
+        if (ptr) {
+            pool_free(pool, ptr, osize);
+            count_allocation(pool, osize, 0);
+        }
+        return NULL;
+    }
+    if (!ptr) {
+        void *block = pool_alloc(pool, nsize);
+        if (block) count_allocation(pool, 0, nsize);
+        return block;
+    }
+
+    // Lua always reports the block's current size, so the class needs no header
+    bool old_small = osize <= ALLOC_SMALL_MAX, new_small = nsize <= ALLOC_SMALL_MAX;
+    void *block;
+    if (old_small && new_small && class_index(osize) == class_index(nsize)) {
+        block = ptr;
+    } else if (!old_small && !new_small) {
+        block = realloc(ptr, nsize);
+    } else {
+        block = pool_alloc(pool, nsize);
+        if (block) {
+            memcpy(block, ptr, osize < nsize ? osize : nsize);
+            pool_free(pool, ptr, osize);
+        }
+    }
+    if (block) count_allocation(pool, osize, nsize);
+    return block;
+}
+
+void alloc_pool_end_frame(AllocPool *pool) {
+    pool->stats.frame_allocs = pool->current_frame_allocs;
+    pool->stats.frame_bytes = pool->current_frame_bytes;
+    pool->current_frame_allocs = 0;
+    pool->current_frame_bytes = 0;
+}
+
+void alloc_pool_get_stats(const AllocPool *pool, AllocStats *stats) {
+    *stats = pool->stats;
+}
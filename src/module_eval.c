@@ -0,0 +1,469 @@
+#include "module_eval.h"
+#include "module_log.h"
+#include "module_lua.h"
+#include <lauxlib.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef enum {
+    EVAL_KERNEL_PASS,
+    EVAL_KERNEL_CONST,
+    EVAL_KERNEL_ADD,
+    EVAL_KERNEL_MUL,
+    EVAL_KERNEL_LUA,
+    EVAL_KERNEL_FAILED   // a Lua kernel raised an error; outputs stay 0 until the next compile
+} EvalKernel;
+
+// One incoming edge: the 0-based input it feeds and the value it reads
+typedef struct {
+    int input;
+    int source;          // into values
+} EvalInput;
+
+struct EvalGraph {
+    int node_count;      // store->count at compile time
+    int *schedule;       // node indices in evaluation order
+    int scheduled;
+    int *kernel;         // EvalKernel per node
+    int *kernel_ref;     // registry reference of the Lua kernel, LUA_NOREF otherwise
+    int *input_first;    // incoming edges of node i are inputs[input_first[i] .. input_first[i + 1])
+    EvalInput *inputs;
+    int *input_width;    // input connectors per node at compile time; scratch holds the widest
+    int *output_first;   // outputs of node i are out_targets[output_first[i] .. output_first[i + 1])
+    int *out_targets;
+    int *value_first;    // outputs of node i are values[value_first[i] .. value_first[i + 1])
+    double *values;
+    double *scratch;     // input values of the node being evaluated
+    int *refs;           // distinct Lua kernel references, released on recompile
+    int ref_count;
+    int *order;          // position of each node in schedule, -1 when left out
+    uint8_t *dirty;      // set while an update collects the nodes to re-run
+    int *work;           // nodes to re-run, then their schedule positions
+    // Edits since the last run or update; these outlive recompiles
+    int *seeds;          // nodes whose own inputs changed
+    int seed_count;
+    int seed_capacity;
+    bool all_dirty;      // re-run everything: output layout changed or nothing ran yet
+    bool needs_compile;  // connections, kernels or connector counts changed
+    NodeStore *store;    // attached store, NULL when detached
+    lua_State *state;    // state whose connections are listened to
+};
+
+static const struct {
+    const char *name;
+    EvalKernel kernel;
+} builtin_kernels[] = {
+    { "", EVAL_KERNEL_PASS },
+    { "pass", EVAL_KERNEL_PASS },
+    { "const", EVAL_KERNEL_CONST },
+    { "add", EVAL_KERNEL_ADD },
+    { "mul", EVAL_KERNEL_MUL }
+};
+
+EvalGraph* eval_create(void) {
+    return calloc(1, sizeof(EvalGraph));
+}
+
+static void release(EvalGraph *graph, lua_State *L) {
+    for (int i = 0; i < graph->ref_count; i++) {
+        luaL_unref(L, LUA_REGISTRYINDEX, graph->refs[i]);
+    }
+    free(graph->schedule);
+    free(graph->kernel);
+    free(graph->kernel_ref);
+    free(graph->input_first);
+    free(graph->inputs);
+    free(graph->input_width);
+    free(graph->output_first);
+    free(graph->out_targets);
+    free(graph->value_first);
+    free(graph->values);
+    free(graph->scratch);
+    free(graph->refs);
+    free(graph->order);
+    free(graph->dirty);
+    free(graph->work);
+    // Pending edits and the attachment belong to the graph, not to one schedule
+    EvalGraph kept = { 0 };
+    kept.seeds = graph->seeds;
+    kept.seed_count = graph->seed_count;
+    kept.seed_capacity = graph->seed_capacity;
+    kept.all_dirty = graph->all_dirty;
+    kept.needs_compile = graph->needs_compile;
+    kept.store = graph->store;
+    kept.state = graph->state;
+    *graph = kept;
+}
+
+void eval_destroy(EvalGraph *graph, lua_State *L) {
+    if (!graph) return;
+    if (graph->store) {
+        node_store_set_listener(graph->store, NULL, NULL);
+        lua_utils_set_connection_listener(graph->state, NULL, NULL);
+    }
+    release(graph, L);
+    free(graph->seeds);
+    free(graph);
+}
+
+// Remember a node whose inputs changed; past one seed per node a full run is cheaper
+static void add_seed(EvalGraph *graph, int index) {
+    if (graph->all_dirty) return;
+    if (graph->seed_count >= graph->node_count) {
+        graph->all_dirty = true;
+        graph->seed_count = 0;
+        return;
+    }
+    if (graph->seed_count == graph->seed_capacity) {
+        int capacity = graph->seed_capacity ? graph->seed_capacity * 2 : 64;
+        int *seeds = realloc(graph->seeds, capacity * sizeof(int));
+        if (!seeds) {
+            graph->all_dirty = true;
+            return;
+        }
+        graph->seeds = seeds;
+        graph->seed_capacity = capacity;
+    }
+    graph->seeds[graph->seed_count++] = index;
+}
+
+static void on_node_change(void *user, int index, bool structural) {
+    EvalGraph *graph = user;
+    if (structural) {
+        graph->needs_compile = true;
+    }
+    if (index < 0) {
+        graph->all_dirty = true; // nodes were added or removed; indices moved
+    } else {
+        add_seed(graph, index);
+    }
+}
+
+static void on_connection_change(void *user, const LuaConnection *connection, bool added) {
+    (void)added; // adding and removing an edge both change the target's inputs
+    EvalGraph *graph = user;
+    graph->needs_compile = true;
+    if (!connection) {
+        graph->all_dirty = true;
+        return;
+    }
+    // Only the target's input changes; a new source is upstream and already current
+    int to = node_store_find_id(graph->store, connection->to_node);
+    if (to >= 0) {
+        add_seed(graph, to);
+    }
+}
+
+void eval_attach(EvalGraph *graph, lua_State *L, NodeStore *store) {
+    graph->store = store;
+    graph->state = L;
+    node_store_set_listener(store, on_node_change, graph);
+    lua_utils_set_connection_listener(L, on_connection_change, graph);
+}
+
+// Map kernel names to kernels; Lua functions are referenced once per distinct name through
+// the table at cache (name -> reference, or false when kernels[name] is not a function)
+static void resolve_kernel(EvalGraph *graph, lua_State *L, int cache, const char *name, int node) {
+    graph->kernel_ref[node] = LUA_NOREF;
+    for (size_t k = 0; k < SDL_arraysize(builtin_kernels); k++) {
+        if (strcmp(name, builtin_kernels[k].name) == 0) {
+            graph->kernel[node] = builtin_kernels[k].kernel;
+            return;
+        }
+    }
+    if (lua_getfield(L, cache, name) == LUA_TNIL) {
+        lua_pop(L, 1);
+        lua_getglobal(L, "kernels");
+        if (lua_istable(L, -1) && lua_getfield(L, -1, name) == LUA_TFUNCTION) {
+            int ref = luaL_ref(L, LUA_REGISTRYINDEX);
+            graph->refs[graph->ref_count++] = ref;
+            lua_pushinteger(L, ref);
+        } else {
+            if (lua_istable(L, -1)) lua_pop(L, 1);
+            LOG_WARN(LOG_CATEGORY_EVAL, "Unknown kernel '%s'; those nodes pass their inputs through", name);
+            lua_pushboolean(L, false);
+        }
+        lua_remove(L, -2); // kernels
+        lua_pushvalue(L, -1);
+        lua_setfield(L, cache, name);
+    }
+    if (lua_isinteger(L, -1)) {
+        graph->kernel[node] = EVAL_KERNEL_LUA;
+        graph->kernel_ref[node] = (int)lua_tointeger(L, -1);
+    } else {
+        graph->kernel[node] = EVAL_KERNEL_PASS;
+    }
+    lua_pop(L, 1);
+}
+
+// Connections whose endpoints and connectors exist; from_output/to_input are checked
+// against the node's connector counts
+static bool edge_valid(const NodeStore *store, const LuaConnection *edge, int *from, int *to) {
+    *from = node_store_find_id(store, edge->from_node);
+    *to = node_store_find_id(store, edge->to_node);
+    return *from >= 0 && *to >= 0 &&
+           edge->from_output >= 1 && edge->from_output <= store->outputs[*from] &&
+           edge->to_input >= 1 && edge->to_input <= store->inputs[*to];
+}
+
+bool eval_compile(EvalGraph *graph, lua_State *L, const NodeStore *store) {
+    Uint64 start_ns = SDL_GetTicksNS();
+    // Cached outputs are kept if the new layout matches the old one
+    double *old_values = graph->values;
+    int *old_value_first = graph->value_first;
+    int old_count = graph->node_count;
+    graph->values = NULL;
+    graph->value_first = NULL;
+    release(graph, L);
+    int n = store->count;
+    int edge_count;
+    const LuaConnection *edges = lua_utils_get_connections(L, &edge_count);
+    int slots = n + 1;
+    graph->schedule = malloc(slots * sizeof(int));
+    graph->kernel = malloc(slots * sizeof(int));
+    graph->kernel_ref = malloc(slots * sizeof(int));
+    graph->input_first = calloc(slots, sizeof(int));
+    graph->output_first = calloc(slots, sizeof(int));
+    graph->value_first = malloc(slots * sizeof(int));
+    graph->inputs = malloc((edge_count > 0 ? edge_count : 1) * sizeof(EvalInput));
+    graph->input_width = malloc(slots * sizeof(int));
+    graph->out_targets = malloc((edge_count > 0 ? edge_count : 1) * sizeof(int));
+    graph->refs = malloc(slots * sizeof(int));
+    graph->order = malloc(slots * sizeof(int));
+    graph->dirty = calloc(slots, sizeof(uint8_t));
+    graph->work = malloc(slots * sizeof(int));
+    if (!graph->schedule || !graph->kernel || !graph->kernel_ref || !graph->input_first || !graph->output_first ||
+        !graph->value_first || !graph->inputs || !graph->input_width || !graph->out_targets || !graph->refs || !graph->order ||
+        !graph->dirty || !graph->work) {
+        LOG_ERROR(LOG_CATEGORY_EVAL, "Failed to allocate schedule for %d nodes and %d connections", n, edge_count);
+        free(old_values);
+        free(old_value_first);
+        release(graph, L);
+        graph->needs_compile = graph->all_dirty = true;
+        return false;
+    }
+
+    // Output values and the widest input row
+    int value_count = 0, max_inputs = 1;
+    for (int i = 0; i < n; i++) {
+        graph->value_first[i] = value_count;
+        value_count += store->outputs[i] > 0 ? store->outputs[i] : 0;
+        graph->input_width[i] = store->inputs[i] > 0 ? store->inputs[i] : 0;
+        if (graph->input_width[i] > max_inputs) max_inputs = graph->input_width[i];
+    }
+    graph->value_first[n] = value_count;
+    if (old_values && old_count == n && memcmp(old_value_first, graph->value_first, slots * sizeof(int)) == 0) {
+        graph->values = old_values;
+    } else {
+        free(old_values);
+        graph->values = calloc(value_count > 0 ? value_count : 1, sizeof(double));
+        graph->all_dirty = true;
+    }
+    free(old_value_first);
+    graph->scratch = malloc(max_inputs * sizeof(double));
+    if (!graph->values || !graph->scratch) {
+        LOG_ERROR(LOG_CATEGORY_EVAL, "Failed to allocate %d output values", value_count);
+        release(graph, L);
+        graph->needs_compile = graph->all_dirty = true;
+        return false;
+    }
+
+    // Pack incoming and outgoing edges per node (counting sort: count, prefix sum, fill)
+    int from, to;
+    for (int e = 0; e < edge_count; e++) {
+        if (edge_valid(store, &edges[e], &from, &to)) {
+            graph->input_first[to + 1]++;
+            graph->output_first[from + 1]++;
+        }
+    }
+    for (int i = 0; i < n; i++) {
+        graph->input_first[i + 1] += graph->input_first[i];
+        graph->output_first[i + 1] += graph->output_first[i];
+    }
+    int *in_fill = graph->schedule, *out_fill = graph->kernel; // scratch until the schedule is built
+    memcpy(in_fill, graph->input_first, n * sizeof(int));
+    memcpy(out_fill, graph->output_first, n * sizeof(int));
+    for (int e = 0; e < edge_count; e++) {
+        if (edge_valid(store, &edges[e], &from, &to)) {
+            graph->inputs[in_fill[to]++] = (EvalInput){ edges[e].to_input - 1, graph->value_first[from] + edges[e].from_output - 1 };
+            graph->out_targets[out_fill[from]++] = to;
+        }
+    }
+
+    // Kahn's algorithm: the schedule doubles as the queue; kernel_ref holds pending in-degrees
+    int *pending = graph->kernel_ref;
+    int tail = 0;
+    for (int i = 0; i < n; i++) {
+        pending[i] = graph->input_first[i + 1] - graph->input_first[i];
+        if (pending[i] == 0) graph->schedule[tail++] = i;
+    }
+    for (int head = 0; head < tail; head++) {
+        int node = graph->schedule[head];
+        for (int k = graph->output_first[node]; k < graph->output_first[node + 1]; k++) {
+            int target = graph->out_targets[k];
+            if (--pending[target] == 0) graph->schedule[tail++] = target;
+        }
+    }
+    graph->scheduled = tail;
+    graph->node_count = n;
+    graph->needs_compile = false;
+    for (int i = 0; i < n; i++) graph->order[i] = -1;
+    for (int s = 0; s < tail; s++) graph->order[graph->schedule[s]] = s;
+    for (int i = 0; i < n && tail < n; i++) {
+        if (graph->order[i] < 0) {
+            // A new cycle may have cut off nodes that were evaluated before
+            for (int v = graph->value_first[i]; v < graph->value_first[i + 1]; v++) graph->values[v] = 0.0;
+        }
+    }
+
+    lua_newtable(L);
+    int cache = lua_gettop(L);
+    for (int i = 0; i < n; i++) {
+        resolve_kernel(graph, L, cache, node_store_kernel(store, i), i);
+    }
+    lua_pop(L, 1);
+
+    bool acyclic = tail == n;
+    if (!acyclic) {
+        LOG_WARN(LOG_CATEGORY_EVAL, "Connections form a cycle; %d of %d nodes are not evaluated", n - tail, n);
+    }
+    LOG_DEBUG(LOG_CATEGORY_EVAL, "Compiled %d nodes, %d connections, %d Lua kernels in %.2f ms",
+              n, graph->input_first[n], graph->ref_count, (SDL_GetTicksNS() - start_ns) / 1e6);
+    return acyclic;
+}
+
+// Connector counts come from the compiled layout: scripts (or a Lua kernel mid-pass) may
+// change the store's counts, which only takes effect at the next compile
+static void eval_node(EvalGraph *graph, lua_State *L, const NodeStore *store, int node) {
+    int input_count = graph->input_width[node];
+    double *in = graph->scratch;
+    for (int j = 0; j < input_count; j++) in[j] = 0.0;
+    for (int k = graph->input_first[node]; k < graph->input_first[node + 1]; k++) {
+        in[graph->inputs[k].input] += graph->values[graph->inputs[k].source];
+    }
+    double *out = graph->values + graph->value_first[node];
+    int output_count = graph->value_first[node + 1] - graph->value_first[node];
+    double value = store->value[node];
+    double result = value;
+    switch (graph->kernel[node]) {
+    case EVAL_KERNEL_PASS:
+        for (int j = 0; j < output_count; j++) out[j] = j < input_count ? in[j] : 0.0;
+        return;
+    case EVAL_KERNEL_CONST:
+        break;
+    case EVAL_KERNEL_ADD:
+        for (int j = 0; j < input_count; j++) result += in[j];
+        break;
+    case EVAL_KERNEL_MUL:
+        for (int j = 0; j < input_count; j++) result *= in[j];
+        break;
+    case EVAL_KERNEL_LUA:
+        luaL_checkstack(L, input_count + output_count + 2, "kernel arguments");
+        lua_rawgeti(L, LUA_REGISTRYINDEX, graph->kernel_ref[node]);
+        lua_pushnumber(L, value);
+        for (int j = 0; j < input_count; j++) lua_pushnumber(L, in[j]);
+        if (lua_pcall(L, input_count + 1, output_count, 0) != LUA_OK) {
+            LOG_ERROR(LOG_CATEGORY_EVAL, "Kernel '%s' of node %d failed: %s", node_store_kernel(store, node),
+                      store->id[node], lua_tostring(L, -1));
+            lua_pop(L, 1);
+            graph->kernel[node] = EVAL_KERNEL_FAILED;
+            for (int j = 0; j < output_count; j++) out[j] = 0.0;
+            return;
+        }
+        for (int j = 0; j < output_count; j++) {
+            out[j] = lua_tonumber(L, j - output_count); // nil and non-numbers read as 0
+        }
+        lua_pop(L, output_count);
+        return;
+    default:
+        return;
+    }
+    for (int j = 0; j < output_count; j++) out[j] = result;
+}
+
+// Recompile when an attached store or state reported a structural change (or, when
+// detached, the node count no longer matches); true when it did
+static bool ensure_compiled(EvalGraph *graph, lua_State *L, const NodeStore *store) {
+    if (!graph->needs_compile && graph->node_count == store->count && graph->values) {
+        return false;
+    }
+    eval_compile(graph, L, store);
+    return true;
+}
+
+int eval_run(EvalGraph *graph, lua_State *L, const NodeStore *store) {
+    ensure_compiled(graph, L, store);
+    // Cleared before running: edits made by Lua kernels during the pass seed the next update
+    graph->seed_count = 0;
+    graph->all_dirty = false;
+    for (int s = 0; s < graph->scheduled; s++) {
+        eval_node(graph, L, store, graph->schedule[s]);
+    }
+    return graph->scheduled;
+}
+
+static int compare_positions(const void *a, const void *b) {
+    int left = *(const int*)a, right = *(const int*)b;
+    return left < right ? -1 : left > right;
+}
+
+int eval_update(EvalGraph *graph, lua_State *L, const NodeStore *store, EvalStats *stats) {
+    bool recompiled = ensure_compiled(graph, L, store);
+    int evaluated;
+    if (graph->all_dirty || !graph->values) {
+        evaluated = eval_run(graph, L, store);
+    } else {
+        // Breadth-first over outgoing edges from the seeds; each node is queued once
+        int count = 0;
+        for (int k = 0; k < graph->seed_count; k++) {
+            int seed = graph->seeds[k];
+            if (seed < graph->node_count && graph->order[seed] >= 0 && !graph->dirty[seed]) {
+                graph->dirty[seed] = 1;
+                graph->work[count++] = seed;
+            }
+        }
+        // The seeds now live in work; edits made by Lua kernels during the pass seed the next update
+        graph->seed_count = 0;
+        for (int head = 0; head < count; head++) {
+            int node = graph->work[head];
+            for (int k = graph->output_first[node]; k < graph->output_first[node + 1]; k++) {
+                int target = graph->out_targets[k];
+                if (!graph->dirty[target] && graph->order[target] >= 0) {
+                    graph->dirty[target] = 1;
+                    graph->work[count++] = target;
+                }
+            }
+        }
+        // Run them in schedule order so every input is current when read
+        for (int k = 0; k < count; k++) {
+            graph->dirty[graph->work[k]] = 0;
+            graph->work[k] = graph->order[graph->work[k]];
+        }
+        qsort(graph->work, count, sizeof(int), compare_positions);
+        for (int k = 0; k < count; k++) {
+            eval_node(graph, L, store, graph->schedule[graph->work[k]]);
+        }
+        evaluated = count;
+    }
+    if (stats) {
+        stats->evaluated = evaluated;
+        stats->skipped = graph->scheduled - evaluated;
+        stats->recompiled = recompiled;
+    }
+    LOG_TRACE(LOG_CATEGORY_EVAL, "Update re-ran %d of %d nodes%s", evaluated, graph->scheduled,
+              recompiled ? " after recompiling" : "");
+    return evaluated;
+}
+
+double eval_output(const EvalGraph *graph, int index, int output) {
+    if (index < 0 || index >= graph->node_count || output < 0 ||
+        output >= graph->value_first[index + 1] - graph->value_first[index]) {
+        return 0.0;
+    }
+    return graph->values[graph->value_first[index] + output];
+}
+
+int eval_scheduled_count(const EvalGraph *graph) {
+    return graph->scheduled;
+}
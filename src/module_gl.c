@@ -1,54 +1,139 @@
 #include "module_gl.h"
+#include "module_log.h"
 #include <SDL3/SDL.h>
 #include <SDL3_ttf/SDL_ttf.h>
 #include <glad/gl.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <stdbool.h>
 
-// Vertex shader for square, circle, and line (no texture coordinates)
+// Vertex shader for square, circle, and line (position + per-vertex color)
 static const char *vertexShaderSource = R"(
 #version 330 core
 layout (location = 0) in vec2 aPos;
-uniform mat4 projection;
+layout (location = 1) in vec4 aColor;
+out vec4 vColor;
+layout (std140) uniform Camera {
+    mat4 projection;
+    float pixelSize;
+};
 void main() {
     gl_Position = projection * vec4(aPos, 0.0, 1.0);
+    vColor = aColor;
 }
 )";
 
 // Fragment shader for square, circle, and line (solid color)
 static const char *fragmentShaderSource = R"(
 #version 330 core
+in vec4 vColor;
 out vec4 FragColor;
-uniform vec3 color;
 void main() {
-    FragColor = vec4(color, 1.0);
+    FragColor = vColor;
 }
 )";
 
-// Vertex shader for text
+// Vertex shader for instanced shapes: a unit quad expanded around each instance,
+// passing the local offset so the fragment shader can evaluate a signed distance
+static const char *instanceVertexShaderSource = R"(
+#version 330 core
+layout (location = 0) in vec2 aPos;
+layout (location = 1) in vec4 aInstance;
+layout (location = 2) in vec4 aColor;
+layout (location = 3) in uint aFlags;
+out vec4 vColor;
+out vec2 vLocal;
+flat out float vExtent;
+flat out float vParam;
+flat out uint vShape;
+layout (std140) uniform Camera {
+    mat4 projection;
+    float pixelSize;
+};
+void main() {
+    uint shape = (aFlags >> 8) & 0xFFu;
+    float extent = shape == 1u ? aInstance.z * 0.5 : aInstance.z;
+    float param = aInstance.w;
+    if ((aFlags & 1u) != 0u) {
+        extent *= 1.2;
+        param *= 1.2;
+    }
+    if ((aFlags & 2u) != 0u) {
+        extent *= 1.2;
+        param *= 1.2;
+    }
+    // One pixel of margin so the anti-aliased edge is not clipped by the quad
+    vec2 local = aPos * (extent + pixelSize);
+    gl_Position = projection * vec4(aInstance.xy + local, 0.0, 1.0);
+    vColor = aColor;
+    vLocal = local;
+    vExtent = extent;
+    vParam = param;
+    vShape = shape;
+}
+)";
+
+// Fragment shader for instanced shapes: circle, rounded rect or outline ring SDF
+// with analytic anti-aliasing over one screen pixel
+static const char *instanceFragmentShaderSource = R"(
+#version 330 core
+in vec4 vColor;
+in vec2 vLocal;
+flat in float vExtent;
+flat in float vParam;
+flat in uint vShape;
+out vec4 FragColor;
+void main() {
+    float d;
+    if (vShape == 1u) {
+        // Rounded rect, vParam = corner radius
+        float radius = min(vParam, vExtent);
+        vec2 q = abs(vLocal) - vec2(vExtent - radius);
+        d = length(max(q, 0.0)) + min(max(q.x, q.y), 0.0) - radius;
+    } else if (vShape == 2u) {
+        // Ring, vParam = stroke width measured inward from the outer radius
+        d = abs(length(vLocal) - vExtent + vParam * 0.5) - vParam * 0.5;
+    } else {
+        d = length(vLocal) - vExtent;
+    }
+    float alpha = clamp(0.5 - d / fwidth(d), 0.0, 1.0);
+    if (alpha <= 0.0) discard;
+    FragColor = vec4(vColor.rgb, vColor.a * alpha);
+}
+)";
+
+// Vertex shader for text: atlas coordinates arrive in texels so growing the
+// atlas never invalidates vertices that were already batched
 static const char *textVertexShaderSource = R"(
 #version 330 core
 layout (location = 0) in vec2 aPos;
 layout (location = 1) in vec2 aTexCoord;
+layout (location = 2) in vec4 aColor;
 out vec2 TexCoord;
-uniform mat4 projection;
+out vec4 vColor;
+layout (std140) uniform Camera {
+    mat4 projection;
+    float pixelSize;
+};
+uniform sampler2D textTexture;
 void main() {
     gl_Position = projection * vec4(aPos, 0.0, 1.0);
-    TexCoord = aTexCoord;
+    TexCoord = aTexCoord / vec2(textureSize(textTexture, 0));
+    vColor = aColor;
 }
 )";
 
-// Fragment shader for text
+// Fragment shader for text: the single-channel atlas holds glyph coverage
 static const char *textFragmentShaderSource = R"(
 #version 330 core
 in vec2 TexCoord;
+in vec4 vColor;
 out vec4 FragColor;
 uniform sampler2D textTexture;
 void main() {
-    vec4 texColor = texture(textTexture, TexCoord);
-    if (texColor.a < 0.1) discard;
-    FragColor = vec4(1.0, 1.0, 1.0, texColor.a);
+    FragColor = vec4(vColor.rgb, vColor.a * texture(textTexture, TexCoord).r);
 }
 )";
 
@@ -61,7 +146,7 @@ static GLuint compile_shader(GLenum type, const char *source) {
     if (!success) {
         char info_log[512];
         glGetShaderInfoLog(shader, 512, NULL, info_log);
-        SDL_Log("Shader compilation failed: %s", info_log);
+        LOG_ERROR(LOG_CATEGORY_RENDER, "Shader compilation failed: %s", info_log);
         glDeleteShader(shader);
         return 0;
     }
@@ -85,7 +170,7 @@ static GLuint create_shader_program(const char *vertex_source, const char *fragm
     if (!success) {
         char info_log[512];
         glGetProgramInfoLog(program, 512, NULL, info_log);
-        SDL_Log("Shader program linking failed: %s", info_log);
+        LOG_ERROR(LOG_CATEGORY_RENDER, "Shader program linking failed: %s", info_log);
         glDeleteProgram(program);
         glDeleteShader(vertex_shader);
         glDeleteShader(fragment_shader);
@@ -96,17 +181,657 @@ static GLuint create_shader_program(const char *vertex_source, const char *fragm
     return program;
 }
 
+// Programs and uniform locations, compiled once for the lifetime of the GL context
+typedef struct {
+    GLuint solid_program;
+    GLuint instance_program;
+    GLuint text_program;
+    GLint text_texture_loc;
+} ShaderRegistry;
+
+// Every program reads the frame camera from this uniform buffer binding
+enum { CAMERA_UBO_BINDING = 0 };
+
+static ShaderRegistry shaders = {0};
+
+static void destroy_shader_registry(void) {
+    if (shaders.solid_program) glDeleteProgram(shaders.solid_program);
+    if (shaders.instance_program) glDeleteProgram(shaders.instance_program);
+    if (shaders.text_program) glDeleteProgram(shaders.text_program);
+    memset(&shaders, 0, sizeof(shaders));
+}
+
+static bool create_shader_registry(void) {
+    shaders.solid_program = create_shader_program(vertexShaderSource, fragmentShaderSource);
+    shaders.instance_program = create_shader_program(instanceVertexShaderSource, instanceFragmentShaderSource);
+    shaders.text_program = create_shader_program(textVertexShaderSource, textFragmentShaderSource);
+    if (!shaders.solid_program || !shaders.instance_program || !shaders.text_program) {
+        destroy_shader_registry();
+        return false;
+    }
+    GLuint programs[] = { shaders.solid_program, shaders.instance_program, shaders.text_program };
+    for (size_t i = 0; i < sizeof(programs) / sizeof(programs[0]); i++) {
+        GLuint block = glGetUniformBlockIndex(programs[i], "Camera");
+        if (block != GL_INVALID_INDEX) glUniformBlockBinding(programs[i], block, CAMERA_UBO_BINDING);
+    }
+    shaders.text_texture_loc = glGetUniformLocation(shaders.text_program, "textTexture");
+
+    // The text sampler always reads from texture unit 0
+    glUseProgram(shaders.text_program);
+    glUniform1i(shaders.text_texture_loc, 0);
+    glUseProgram(0);
+    return true;
+}
+
+// Frame camera: the cached window size and the camera values of the last frame.
+// The projection is rebuilt and uploaded to the shared uniform buffer only when
+// one of them changes, so an idle camera costs no matrix math or uniform traffic.
+typedef struct {
+    GLuint ubo;
+    int win_width;
+    int win_height;
+    float cam_x;
+    float cam_y;
+    float cam_scale;
+    float visible_min_x, visible_min_y; // world rectangle covered by the window
+    float visible_max_x, visible_max_y;
+    bool dirty;
+} FrameCamera;
+
+// std140 layout of the Camera block
+typedef struct {
+    float projection[16];
+    float pixel_size; // world units covered by one screen pixel
+    float padding[3];
+} CameraBlock;
+
+static FrameCamera camera = {0};
+
+static void destroy_frame_camera(void) {
+    if (camera.ubo) glDeleteBuffers(1, &camera.ubo);
+    memset(&camera, 0, sizeof(camera));
+}
+
+static bool create_frame_camera(int win_width, int win_height) {
+    glGenBuffers(1, &camera.ubo);
+    glBindBuffer(GL_UNIFORM_BUFFER, camera.ubo);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(CameraBlock), NULL, GL_DYNAMIC_DRAW);
+    glBindBufferBase(GL_UNIFORM_BUFFER, CAMERA_UBO_BINDING, camera.ubo);
+    camera.win_width = win_width;
+    camera.win_height = win_height;
+    camera.cam_scale = 1.0f;
+    camera.dirty = true;
+    return camera.ubo != 0;
+}
+
+static void upload_frame_camera(void) {
+    float cam_x = camera.cam_x;
+    float cam_y = camera.cam_y;
+    float cam_scale = camera.cam_scale;
+    float win_width = (float)(camera.win_width > 0 ? camera.win_width : 1);
+    float win_height = (float)(camera.win_height > 0 ? camera.win_height : 1);
+    CameraBlock block = {
+        {
+            2.0f * cam_scale / win_width, 0.0f, 0.0f, 0.0f,
+            0.0f, -2.0f * cam_scale / win_height, 0.0f, 0.0f,
+            0.0f, 0.0f, 1.0f, 0.0f,
+            -cam_x * 2.0f * cam_scale / win_width - 1.0f, cam_y * 2.0f * cam_scale / win_height + 1.0f, 0.0f, 1.0f
+        },
+        1.0f / cam_scale,
+        { 0.0f, 0.0f, 0.0f }
+    };
+    glBindBuffer(GL_UNIFORM_BUFFER, camera.ubo);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(block), &block);
+    camera.visible_min_x = cam_x;
+    camera.visible_min_y = cam_y;
+    camera.visible_max_x = cam_x + win_width / cam_scale;
+    camera.visible_max_y = cam_y + win_height / cam_scale;
+    camera.dirty = false;
+}
+
+// Solid primitive batch: every square, circle and line of a frame is appended
+// to one CPU-side vertex array and streamed into a single VBO on flush.
+// Consecutive primitives of the same GL mode share one draw call.
+typedef struct {
+    float x, y;
+    Uint8 r, g, b, a;
+} BatchVertex;
+
+typedef struct {
+    GLenum mode;
+    GLint first;
+    GLsizei count;
+} BatchRange;
+
+typedef struct {
+    GLuint vao;
+    GLuint vbo;
+    GLsizeiptr vbo_capacity; // bytes allocated on the GPU
+    BatchVertex *vertices;
+    int vertex_count;
+    int vertex_capacity;
+    BatchRange *ranges;
+    int range_count;
+    int range_capacity;
+} SolidBatch;
+
+static SolidBatch batch = {0};
+
+static void destroy_solid_batch(void) {
+    if (batch.vao) glDeleteVertexArrays(1, &batch.vao);
+    if (batch.vbo) glDeleteBuffers(1, &batch.vbo);
+    free(batch.vertices);
+    free(batch.ranges);
+    memset(&batch, 0, sizeof(batch));
+}
+
+static bool create_solid_batch(void) {
+    glGenVertexArrays(1, &batch.vao);
+    glGenBuffers(1, &batch.vbo);
+    glBindVertexArray(batch.vao);
+    glBindBuffer(GL_ARRAY_BUFFER, batch.vbo);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(BatchVertex), (void*)offsetof(BatchVertex, x));
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(BatchVertex), (void*)offsetof(BatchVertex, r));
+    glEnableVertexAttribArray(1);
+    glBindVertexArray(0);
+    return batch.vao && batch.vbo;
+}
+
+// Reserve room for `count` vertices of `mode`, merging with the previous range when possible
+static BatchVertex* batch_reserve(GLenum mode, int count) {
+    if (batch.vertex_count + count > batch.vertex_capacity) {
+        int capacity = batch.vertex_capacity ? batch.vertex_capacity : 1024;
+        while (capacity < batch.vertex_count + count) capacity *= 2;
+        BatchVertex *vertices = realloc(batch.vertices, capacity * sizeof(BatchVertex));
+        if (!vertices) {
+            LOG_ERROR(LOG_CATEGORY_RENDER, "Failed to grow vertex batch to %d vertices", capacity);
+            return NULL;
+        }
+        batch.vertices = vertices;
+        batch.vertex_capacity = capacity;
+    }
+    BatchRange *last = batch.range_count > 0 ? &batch.ranges[batch.range_count - 1] : NULL;
+    if (last && last->mode == mode) {
+        last->count += count;
+    } else {
+        if (batch.range_count == batch.range_capacity) {
+            int capacity = batch.range_capacity ? batch.range_capacity * 2 : 16;
+            BatchRange *ranges = realloc(batch.ranges, capacity * sizeof(BatchRange));
+            if (!ranges) {
+                LOG_ERROR(LOG_CATEGORY_RENDER, "Failed to grow batch ranges to %d", capacity);
+                return NULL;
+            }
+            batch.ranges = ranges;
+            batch.range_capacity = capacity;
+        }
+        batch.ranges[batch.range_count++] = (BatchRange){ mode, batch.vertex_count, count };
+    }
+    BatchVertex *out = &batch.vertices[batch.vertex_count];
+    batch.vertex_count += count;
+    return out;
+}
+
+static Uint8 color_byte(float c) {
+    if (c <= 0.0f) return 0;
+    if (c >= 1.0f) return 255;
+    return (Uint8)(c * 255.0f + 0.5f);
+}
+
+static BatchVertex batch_vertex(float x, float y, float r, float g, float b, float a) {
+    return (BatchVertex){ x, y, color_byte(r), color_byte(g), color_byte(b), color_byte(a) };
+}
+
+// Instanced shapes: every node and connector is the same unit quad, shaped by
+// the SDF fragment shader, so an instance costs four vertices and no CPU trig.
+typedef struct {
+    GLuint vao;
+    GLuint instance_vbo;
+    GLsizeiptr instance_capacity; // bytes allocated on the GPU
+    RenderInstance *instances;
+    int count;
+    int capacity;
+} InstanceList;
+
+static GLuint quad_mesh_vbo = 0;
+static InstanceList node_instances = {0};
+static InstanceList connector_instances = {0};
+
+static void destroy_instance_list(InstanceList *list) {
+    if (list->vao) glDeleteVertexArrays(1, &list->vao);
+    if (list->instance_vbo) glDeleteBuffers(1, &list->instance_vbo);
+    free(list->instances);
+    memset(list, 0, sizeof(*list));
+}
+
+static void destroy_instance_lists(void) {
+    destroy_instance_list(&node_instances);
+    destroy_instance_list(&connector_instances);
+    if (quad_mesh_vbo) glDeleteBuffers(1, &quad_mesh_vbo);
+    quad_mesh_vbo = 0;
+}
+
+static bool create_instance_list(InstanceList *list) {
+    glGenVertexArrays(1, &list->vao);
+    glGenBuffers(1, &list->instance_vbo);
+    glBindVertexArray(list->vao);
+
+    glBindBuffer(GL_ARRAY_BUFFER, quad_mesh_vbo);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+
+    glBindBuffer(GL_ARRAY_BUFFER, list->instance_vbo);
+    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(RenderInstance), (void*)offsetof(RenderInstance, x));
+    glEnableVertexAttribArray(1);
+    glVertexAttribDivisor(1, 1);
+    glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(RenderInstance), (void*)offsetof(RenderInstance, r));
+    glEnableVertexAttribArray(2);
+    glVertexAttribDivisor(2, 1);
+    glVertexAttribIPointer(3, 1, GL_UNSIGNED_INT, sizeof(RenderInstance), (void*)offsetof(RenderInstance, flags));
+    glEnableVertexAttribArray(3);
+    glVertexAttribDivisor(3, 1);
+
+    glBindVertexArray(0);
+    return list->vao && list->instance_vbo;
+}
+
+static bool create_instance_lists(void) {
+    // Unit quad in [-1, 1]; the vertex shader scales it to the shape extent
+    static const float quad[] = {
+        -1.0f, -1.0f,
+         1.0f, -1.0f,
+         1.0f,  1.0f,
+        -1.0f,  1.0f
+    };
+    glGenBuffers(1, &quad_mesh_vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, quad_mesh_vbo);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(quad), quad, GL_STATIC_DRAW);
+    return quad_mesh_vbo && create_instance_list(&node_instances) && create_instance_list(&connector_instances);
+}
+
+static void push_instance(InstanceList *list, float x, float y, float size, float param, float r, float g, float b, unsigned int flags) {
+    if (list->count == list->capacity) {
+        int capacity = list->capacity ? list->capacity * 2 : 256;
+        RenderInstance *instances = realloc(list->instances, capacity * sizeof(RenderInstance));
+        if (!instances) {
+            LOG_ERROR(LOG_CATEGORY_RENDER, "Failed to grow instance list to %d", capacity);
+            return;
+        }
+        list->instances = instances;
+        list->capacity = capacity;
+    }
+    list->instances[list->count++] = (RenderInstance){
+        x, y, size, param, color_byte(r), color_byte(g), color_byte(b), 255, flags
+    };
+}
+
+static void flush_instance_list(InstanceList *list) {
+    if (list->count == 0) return;
+    GLsizeiptr bytes = (GLsizeiptr)list->count * sizeof(RenderInstance);
+    glBindVertexArray(list->vao);
+    glBindBuffer(GL_ARRAY_BUFFER, list->instance_vbo);
+    if (bytes > list->instance_capacity) {
+        GLsizeiptr capacity = list->instance_capacity ? list->instance_capacity : 16 * 1024;
+        while (capacity < bytes) capacity *= 2;
+        list->instance_capacity = capacity;
+    }
+    glBufferData(GL_ARRAY_BUFFER, list->instance_capacity, NULL, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, list->instances);
+    glDrawArraysInstanced(GL_TRIANGLE_FAN, 0, 4, list->count);
+    list->count = 0;
+}
+
+// Glyph atlas: each glyph of the font is rasterized once with TTF_RenderGlyph_Blended,
+// shelf-packed into a single-channel texture and then drawn as textured quads from
+// the text batch. The atlas keeps a CPU copy so it can grow by doubling its height.
+enum {
+    ATLAS_WIDTH = 512,
+    ATLAS_INITIAL_HEIGHT = 256,
+    ATLAS_MAX_HEIGHT = 4096,
+    ATLAS_PADDING = 1,
+    ATLAS_WHITE_SIZE = 4 // opaque block at the origin used for label backgrounds
+};
+
+typedef struct {
+    Uint32 codepoint;
+    bool used;
+    Uint16 x, y;       // texel position in the atlas
+    Uint16 w, h;       // rasterized size, zero for blank glyphs
+    int advance;
+} Glyph;
+
+typedef struct {
+    TTF_Font *font;
+    GLuint texture;
+    Uint8 *pixels;
+    int height;
+    int shelf_x, shelf_y, shelf_height;
+    int line_height;
+    Glyph *glyphs;     // open-addressing table keyed by codepoint
+    int glyph_count;
+    int glyph_capacity;
+} GlyphAtlas;
+
+typedef struct {
+    float x, y;
+    float u, v;        // atlas texels
+    Uint8 r, g, b, a;
+} TextVertex;
+
+typedef struct {
+    GLuint vao;
+    GLuint vbo;
+    GLsizeiptr vbo_capacity;
+    TextVertex *vertices;
+    int vertex_count;
+    int vertex_capacity;
+} TextBatch;
+
+static GlyphAtlas atlas = {0};
+static TextBatch text_batch = {0};
+
+static void atlas_upload(int x, int y, int w, int h) {
+    glBindTexture(GL_TEXTURE_2D, atlas.texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, ATLAS_WIDTH);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, w, h, GL_RED, GL_UNSIGNED_BYTE, atlas.pixels + (size_t)y * ATLAS_WIDTH + x);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+}
+
+static bool atlas_resize(int height) {
+    Uint8 *pixels = realloc(atlas.pixels, (size_t)ATLAS_WIDTH * height);
+    if (!pixels) {
+        LOG_ERROR(LOG_CATEGORY_RENDER, "Failed to grow glyph atlas to %dx%d", ATLAS_WIDTH, height);
+        return false;
+    }
+    memset(pixels + (size_t)ATLAS_WIDTH * atlas.height, 0, (size_t)ATLAS_WIDTH * (height - atlas.height));
+    atlas.pixels = pixels;
+    atlas.height = height;
+    glBindTexture(GL_TEXTURE_2D, atlas.texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, ATLAS_WIDTH, height, 0, GL_RED, GL_UNSIGNED_BYTE, atlas.pixels);
+    return true;
+}
+
+static void atlas_reset(TTF_Font *font) {
+    atlas.font = font;
+    atlas.line_height = font ? TTF_GetFontHeight(font) : 0;
+    memset(atlas.pixels, 0, (size_t)ATLAS_WIDTH * atlas.height);
+    for (int y = 0; y < ATLAS_WHITE_SIZE; y++) {
+        memset(atlas.pixels + (size_t)y * ATLAS_WIDTH, 255, ATLAS_WHITE_SIZE);
+    }
+    atlas.shelf_x = ATLAS_WHITE_SIZE + ATLAS_PADDING;
+    atlas.shelf_y = 0;
+    atlas.shelf_height = ATLAS_WHITE_SIZE;
+    if (atlas.glyphs) memset(atlas.glyphs, 0, atlas.glyph_capacity * sizeof(Glyph));
+    atlas.glyph_count = 0;
+    atlas_upload(0, 0, ATLAS_WIDTH, atlas.height);
+}
+
+static void destroy_glyph_atlas(void) {
+    if (atlas.texture) glDeleteTextures(1, &atlas.texture);
+    free(atlas.pixels);
+    free(atlas.glyphs);
+    memset(&atlas, 0, sizeof(atlas));
+    if (text_batch.vao) glDeleteVertexArrays(1, &text_batch.vao);
+    if (text_batch.vbo) glDeleteBuffers(1, &text_batch.vbo);
+    free(text_batch.vertices);
+    memset(&text_batch, 0, sizeof(text_batch));
+}
+
+static bool create_glyph_atlas(void) {
+    glGenTextures(1, &atlas.texture);
+    glBindTexture(GL_TEXTURE_2D, atlas.texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    if (!atlas_resize(ATLAS_INITIAL_HEIGHT)) return false;
+    atlas_reset(NULL);
+
+    glGenVertexArrays(1, &text_batch.vao);
+    glGenBuffers(1, &text_batch.vbo);
+    glBindVertexArray(text_batch.vao);
+    glBindBuffer(GL_ARRAY_BUFFER, text_batch.vbo);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(TextVertex), (void*)offsetof(TextVertex, x));
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(TextVertex), (void*)offsetof(TextVertex, u));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(TextVertex), (void*)offsetof(TextVertex, r));
+    glEnableVertexAttribArray(2);
+    glBindVertexArray(0);
+    return atlas.texture && text_batch.vao && text_batch.vbo;
+}
+
+// Find a free rectangle on the current shelf, opening new shelves and growing the atlas as needed
+static bool atlas_pack(int w, int h, int *out_x, int *out_y) {
+    if (w + ATLAS_PADDING > ATLAS_WIDTH) return false;
+    if (atlas.shelf_x + w + ATLAS_PADDING > ATLAS_WIDTH) {
+        atlas.shelf_y += atlas.shelf_height + ATLAS_PADDING;
+        atlas.shelf_x = 0;
+        atlas.shelf_height = 0;
+    }
+    while (atlas.shelf_y + h > atlas.height) {
+        if (atlas.height >= ATLAS_MAX_HEIGHT || !atlas_resize(atlas.height * 2)) return false;
+    }
+    *out_x = atlas.shelf_x;
+    *out_y = atlas.shelf_y;
+    atlas.shelf_x += w + ATLAS_PADDING;
+    if (h > atlas.shelf_height) atlas.shelf_height = h;
+    return true;
+}
+
+static Glyph* atlas_lookup(Uint32 codepoint) {
+    if (atlas.glyph_capacity == 0) return NULL;
+    Uint32 mask = atlas.glyph_capacity - 1;
+    for (Uint32 i = (codepoint * 2654435761u) & mask;; i = (i + 1) & mask) {
+        Glyph *glyph = &atlas.glyphs[i];
+        if (!glyph->used || glyph->codepoint == codepoint) return glyph;
+    }
+}
+
+static Glyph* atlas_insert_slot(Uint32 codepoint) {
+    if ((atlas.glyph_count + 1) * 4 > atlas.glyph_capacity * 3) {
+        int capacity = atlas.glyph_capacity ? atlas.glyph_capacity * 2 : 256;
+        Glyph *old = atlas.glyphs;
+        int old_capacity = atlas.glyph_capacity;
+        atlas.glyphs = calloc(capacity, sizeof(Glyph));
+        if (!atlas.glyphs) {
+            atlas.glyphs = old;
+            LOG_ERROR(LOG_CATEGORY_RENDER, "Failed to grow glyph table to %d", capacity);
+            return NULL;
+        }
+        atlas.glyph_capacity = capacity;
+        for (int i = 0; i < old_capacity; i++) {
+            if (old[i].used) *atlas_lookup(old[i].codepoint) = old[i];
+        }
+        free(old);
+    }
+    return atlas_lookup(codepoint);
+}
+
+// Return the cached glyph, rasterizing it into the atlas on first use
+static const Glyph* atlas_get_glyph(TTF_Font *font, Uint32 codepoint) {
+    if (font != atlas.font) atlas_reset(font);
+    Glyph *glyph = atlas_lookup(codepoint);
+    if (glyph && glyph->used) return glyph;
+
+    glyph = atlas_insert_slot(codepoint);
+    if (!glyph) return NULL;
+    memset(glyph, 0, sizeof(*glyph));
+    glyph->codepoint = codepoint;
+    glyph->used = true;
+    atlas.glyph_count++;
+
+    int minx, maxx, miny, maxy;
+    if (!TTF_GetGlyphMetrics(font, codepoint, &minx, &maxx, &miny, &maxy, &glyph->advance)) {
+        glyph->advance = 0;
+    }
+
+    SDL_Color white = {255, 255, 255, 255};
+    SDL_Surface *surface = TTF_RenderGlyph_Blended(font, codepoint, white);
+    if (!surface) return glyph; // blank glyph: advance only
+    SDL_Surface *converted = SDL_ConvertSurface(surface, SDL_PIXELFORMAT_RGBA32);
+    SDL_DestroySurface(surface);
+    if (!converted) {
+        LOG_ERROR(LOG_CATEGORY_RENDER, "SDL_ConvertSurface failed: %s", SDL_GetError());
+        return glyph;
+    }
+
+    int x, y;
+    if (converted->w > 0 && converted->h > 0 && atlas_pack(converted->w, converted->h, &x, &y)) {
+        for (int row = 0; row < converted->h; row++) {
+            const Uint8 *src = (const Uint8 *)converted->pixels + (size_t)row * converted->pitch;
+            Uint8 *dst = atlas.pixels + (size_t)(y + row) * ATLAS_WIDTH + x;
+            for (int col = 0; col < converted->w; col++) {
+                dst[col] = src[col * 4 + 3];
+            }
+        }
+        atlas_upload(x, y, converted->w, converted->h);
+        glyph->x = (Uint16)x;
+        glyph->y = (Uint16)y;
+        glyph->w = (Uint16)converted->w;
+        glyph->h = (Uint16)converted->h;
+    } else if (converted->w > 0 && converted->h > 0) {
+        LOG_WARN(LOG_CATEGORY_RENDER, "Glyph atlas full, dropping glyph U+%04X", (unsigned)codepoint);
+    }
+    SDL_DestroySurface(converted);
+    return glyph;
+}
+
+static TextVertex* text_batch_reserve(int count) {
+    if (text_batch.vertex_count + count > text_batch.vertex_capacity) {
+        int capacity = text_batch.vertex_capacity ? text_batch.vertex_capacity : 1024;
+        while (capacity < text_batch.vertex_count + count) capacity *= 2;
+        TextVertex *vertices = realloc(text_batch.vertices, capacity * sizeof(TextVertex));
+        if (!vertices) {
+            LOG_ERROR(LOG_CATEGORY_RENDER, "Failed to grow text batch to %d vertices", capacity);
+            return NULL;
+        }
+        text_batch.vertices = vertices;
+        text_batch.vertex_capacity = capacity;
+    }
+    TextVertex *out = &text_batch.vertices[text_batch.vertex_count];
+    text_batch.vertex_count += count;
+    return out;
+}
+
+static void text_push_quad(float x1, float y1, float x2, float y2, float u1, float v1, float u2, float v2, SDL_Color color) {
+    TextVertex *v = text_batch_reserve(6);
+    if (!v) return;
+    v[0] = (TextVertex){ x1, y1, u1, v1, color.r, color.g, color.b, color.a };
+    v[1] = (TextVertex){ x2, y1, u2, v1, color.r, color.g, color.b, color.a };
+    v[2] = (TextVertex){ x2, y2, u2, v2, color.r, color.g, color.b, color.a };
+    v[3] = v[2];
+    v[4] = (TextVertex){ x1, y2, u1, v2, color.r, color.g, color.b, color.a };
+    v[5] = v[0];
+}
+
+static void flush_text_batch(void) {
+    if (text_batch.vertex_count == 0 || !shaders.text_program) {
+        text_batch.vertex_count = 0;
+        return;
+    }
+    GLsizeiptr bytes = (GLsizeiptr)text_batch.vertex_count * sizeof(TextVertex);
+    glBindVertexArray(text_batch.vao);
+    glBindBuffer(GL_ARRAY_BUFFER, text_batch.vbo);
+    if (bytes > text_batch.vbo_capacity) {
+        GLsizeiptr capacity = text_batch.vbo_capacity ? text_batch.vbo_capacity : 64 * 1024;
+        while (capacity < bytes) capacity *= 2;
+        text_batch.vbo_capacity = capacity;
+    }
+    glBufferData(GL_ARRAY_BUFFER, text_batch.vbo_capacity, NULL, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, text_batch.vertices);
+
+    glUseProgram(shaders.text_program);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, atlas.texture);
+    glDrawArrays(GL_TRIANGLES, 0, text_batch.vertex_count);
+    glBindVertexArray(0);
+    text_batch.vertex_count = 0;
+}
+
+// Aggregated node tiles for zoomed-out views: nodes are binned into a screen-space
+// grid and each occupied cell becomes one quad, so the draw cost is bounded by the
+// window area instead of the node count. The first node to claim a cell sets its color.
+typedef struct {
+    Uint32 *cells;     // packed RGB + 1 in the top byte when occupied, 0 when empty
+    int cell_capacity;
+    int columns;
+    int rows;
+    float tile_world;  // cell edge in world units
+} TileGrid;
+
+static TileGrid tiles = {0};
+
+static void destroy_tile_grid(void) {
+    free(tiles.cells);
+    memset(&tiles, 0, sizeof(tiles));
+}
+
+void render_tiles_begin(float tile_pixels) {
+    if (tile_pixels < 1.0f) tile_pixels = 1.0f;
+    tiles.tile_world = tile_pixels / camera.cam_scale;
+    tiles.columns = (int)ceilf((camera.visible_max_x - camera.visible_min_x) / tiles.tile_world);
+    tiles.rows = (int)ceilf((camera.visible_max_y - camera.visible_min_y) / tiles.tile_world);
+    int count = tiles.columns * tiles.rows;
+    if (count > tiles.cell_capacity) {
+        Uint32 *cells = realloc(tiles.cells, count * sizeof(Uint32));
+        if (!cells) {
+            LOG_ERROR(LOG_CATEGORY_RENDER, "Failed to grow tile grid to %d cells", count);
+            tiles.columns = tiles.rows = 0;
+            return;
+        }
+        tiles.cells = cells;
+        tiles.cell_capacity = count;
+    }
+    memset(tiles.cells, 0, count * sizeof(Uint32));
+}
+
+void render_tiles_mark(float min_x, float min_y, float max_x, float max_y, float r, float g, float b) {
+    if (tiles.columns == 0 || tiles.rows == 0) return;
+    int x0 = (int)floorf((min_x - camera.visible_min_x) / tiles.tile_world);
+    int y0 = (int)floorf((min_y - camera.visible_min_y) / tiles.tile_world);
+    int x1 = (int)floorf((max_x - camera.visible_min_x) / tiles.tile_world);
+    int y1 = (int)floorf((max_y - camera.visible_min_y) / tiles.tile_world);
+    if (x0 < 0) x0 = 0;
+    if (y0 < 0) y0 = 0;
+    if (x1 >= tiles.columns) x1 = tiles.columns - 1;
+    if (y1 >= tiles.rows) y1 = tiles.rows - 1;
+    Uint32 color = 0x01000000u | ((Uint32)color_byte(r) << 16) | ((Uint32)color_byte(g) << 8) | color_byte(b);
+    for (int y = y0; y <= y1; y++) {
+        Uint32 *row = &tiles.cells[y * tiles.columns];
+        for (int x = x0; x <= x1; x++) {
+            if (!row[x]) row[x] = color;
+        }
+    }
+}
+
+void render_tiles_end(void) {
+    for (int y = 0; y < tiles.rows; y++) {
+        for (int x = 0; x < tiles.columns; x++) {
+            Uint32 color = tiles.cells[y * tiles.columns + x];
+            if (!color) continue;
+            float wx = camera.visible_min_x + x * tiles.tile_world;
+            float wy = camera.visible_min_y + y * tiles.tile_world;
+            render_push_quad(wx, wy, wx + tiles.tile_world, wy + tiles.tile_world,
+                             ((color >> 16) & 0xFF) / 255.0f, ((color >> 8) & 0xFF) / 255.0f, (color & 0xFF) / 255.0f, 1.0f);
+        }
+    }
+    tiles.columns = tiles.rows = 0;
+}
+
 SDL_GLContext init_opengl_context(SDL_Window *window) {
     SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
     SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
     SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
     SDL_GLContext gl_context = SDL_GL_CreateContext(window);
     if (!gl_context) {
-        SDL_Log("SDL_GL_CreateContext failed: %s", SDL_GetError());
+        LOG_ERROR(LOG_CATEGORY_RENDER, "SDL_GL_CreateContext failed: %s", SDL_GetError());
         return NULL;
     }
     if (!gladLoadGL((GLADloadfunc)SDL_GL_GetProcAddress)) {
-        SDL_Log("Failed to initialize GLAD");
+        LOG_ERROR(LOG_CATEGORY_RENDER, "Failed to initialize GLAD");
         SDL_GL_DestroyContext(gl_context);
         return NULL;
     }
@@ -116,210 +841,282 @@ SDL_GLContext init_opengl_context(SDL_Window *window) {
     glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
     glEnable(GL_BLEND);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    if (!create_shader_registry()) {
+        LOG_ERROR(LOG_CATEGORY_RENDER, "Failed to create shader programs");
+        SDL_GL_DestroyContext(gl_context);
+        return NULL;
+    }
+    if (!create_frame_camera(w, h)) {
+        LOG_ERROR(LOG_CATEGORY_RENDER, "Failed to create camera uniform buffer");
+        destroy_frame_camera();
+        destroy_shader_registry();
+        SDL_GL_DestroyContext(gl_context);
+        return NULL;
+    }
+    if (!create_solid_batch()) {
+        LOG_ERROR(LOG_CATEGORY_RENDER, "Failed to create vertex batch");
+        destroy_frame_camera();
+        destroy_shader_registry();
+        SDL_GL_DestroyContext(gl_context);
+        return NULL;
+    }
+    if (!create_instance_lists()) {
+        LOG_ERROR(LOG_CATEGORY_RENDER, "Failed to create instance buffers");
+        destroy_instance_lists();
+        destroy_solid_batch();
+        destroy_frame_camera();
+        destroy_shader_registry();
+        SDL_GL_DestroyContext(gl_context);
+        return NULL;
+    }
+    if (!create_glyph_atlas()) {
+        LOG_ERROR(LOG_CATEGORY_RENDER, "Failed to create glyph atlas");
+        destroy_glyph_atlas();
+        destroy_instance_lists();
+        destroy_solid_batch();
+        destroy_frame_camera();
+        destroy_shader_registry();
+        SDL_GL_DestroyContext(gl_context);
+        return NULL;
+    }
     return gl_context;
 }
 
-void render_square(float x, float y, float size, float r, float g, float b, SDL_Window *window, float cam_x, float cam_y, float cam_scale) {
-    GLuint program = create_shader_program(vertexShaderSource, fragmentShaderSource);
-    if (!program) return;
+void cleanup_opengl_context(SDL_GLContext gl_context) {
+    if (!gl_context) return;
+    destroy_glyph_atlas();
+    destroy_instance_lists();
+    destroy_solid_batch();
+    destroy_tile_grid();
+    destroy_frame_camera();
+    destroy_shader_registry();
+    SDL_GL_DestroyContext(gl_context);
+}
 
-    int win_width, win_height;
-    SDL_GetWindowSize(window, &win_width, &win_height);
-    float ortho[16] = {
-        2.0f * cam_scale / win_width, 0.0f, 0.0f, 0.0f,
-        0.0f, -2.0f * cam_scale / win_height, 0.0f, 0.0f,
-        0.0f, 0.0f, 1.0f, 0.0f,
-        -cam_x * 2.0f * cam_scale / win_width - 1.0f, cam_y * 2.0f * cam_scale / win_height + 1.0f, 0.0f, 1.0f
-    };
+void render_resize(int win_width, int win_height) {
+    if (win_width == camera.win_width && win_height == camera.win_height) return;
+    camera.win_width = win_width;
+    camera.win_height = win_height;
+    camera.dirty = true;
+    glViewport(0, 0, win_width, win_height);
+}
 
-    float half_size = size / 2.0f;
-    float vertices[] = {
-        x - half_size, y - half_size,
-        x + half_size, y - half_size,
-        x + half_size, y + half_size,
-        x - half_size, y + half_size
-    };
-    unsigned int indices[] = { 0, 1, 2, 2, 3, 0 };
-
-    GLuint vao, vbo, ebo;
-    glGenVertexArrays(1, &vao);
-    glGenBuffers(1, &vbo);
-    glGenBuffers(1, &ebo);
-    glBindVertexArray(vao);
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
-    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
+void render_begin_frame(float cam_x, float cam_y, float cam_scale) {
+    if (cam_x != camera.cam_x || cam_y != camera.cam_y || cam_scale != camera.cam_scale) {
+        camera.cam_x = cam_x;
+        camera.cam_y = cam_y;
+        camera.cam_scale = cam_scale;
+        camera.dirty = true;
+    }
+    if (camera.dirty) upload_frame_camera();
+    batch.vertex_count = 0;
+    batch.range_count = 0;
+    node_instances.count = 0;
+    connector_instances.count = 0;
+    text_batch.vertex_count = 0;
+}
 
-    glUseProgram(program);
-    glUniformMatrix4fv(glGetUniformLocation(program, "projection"), 1, GL_FALSE, ortho);
-    glUniform3f(glGetUniformLocation(program, "color"), r, g, b);
-    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+void render_get_visible_rect(float *min_x, float *min_y, float *max_x, float *max_y) {
+    *min_x = camera.visible_min_x;
+    *min_y = camera.visible_min_y;
+    *max_x = camera.visible_max_x;
+    *max_y = camera.visible_max_y;
+}
 
-    glDeleteVertexArrays(1, &vao);
-    glDeleteBuffers(1, &vbo);
-    glDeleteBuffers(1, &ebo);
-    glDeleteProgram(program);
+bool render_rect_visible(float min_x, float min_y, float max_x, float max_y) {
+    return max_x >= camera.visible_min_x && min_x <= camera.visible_max_x &&
+           max_y >= camera.visible_min_y && min_y <= camera.visible_max_y;
 }
 
-void render_circle(float x, float y, float radius, float r, float g, float b, SDL_Window *window, float cam_x, float cam_y, float cam_scale) {
-    GLuint program = create_shader_program(vertexShaderSource, fragmentShaderSource);
-    if (!program) return;
+bool render_segment_visible(float x1, float y1, float x2, float y2) {
+    // Bounding boxes that miss the view reject most segments without clipping
+    if (!render_rect_visible(fminf(x1, x2), fminf(y1, y2), fmaxf(x1, x2), fmaxf(y1, y2))) return false;
 
-    int win_width, win_height;
-    SDL_GetWindowSize(window, &win_width, &win_height);
-    float ortho[16] = {
-        2.0f * cam_scale / win_width, 0.0f, 0.0f, 0.0f,
-        0.0f, -2.0f * cam_scale / win_height, 0.0f, 0.0f,
-        0.0f, 0.0f, 1.0f, 0.0f,
-        -cam_x * 2.0f * cam_scale / win_width - 1.0f, cam_y * 2.0f * cam_scale / win_height + 1.0f, 0.0f, 1.0f
+    // Liang-Barsky: clip the parametric segment against the four view edges
+    float dx = x2 - x1;
+    float dy = y2 - y1;
+    float p[4] = { -dx, dx, -dy, dy };
+    float q[4] = {
+        x1 - camera.visible_min_x, camera.visible_max_x - x1,
+        y1 - camera.visible_min_y, camera.visible_max_y - y1
     };
+    float t0 = 0.0f, t1 = 1.0f;
+    for (int i = 0; i < 4; i++) {
+        if (p[i] == 0.0f) {
+            if (q[i] < 0.0f) return false;
+        } else {
+            float t = q[i] / p[i];
+            if (p[i] < 0.0f) {
+                if (t > t1) return false;
+                if (t > t0) t0 = t;
+            } else {
+                if (t < t0) return false;
+                if (t < t1) t1 = t;
+            }
+        }
+    }
+    return true;
+}
 
-    const int segments = 32;
-    float vertices[(segments + 2) * 2];
-    vertices[0] = x;
-    vertices[1] = y;
-    for (int i = 0; i <= segments; i++) {
-        float angle = i * 2.0f * M_PI / segments;
-        vertices[(i + 1) * 2 + 0] = x + radius * cosf(angle);
-        vertices[(i + 1) * 2 + 1] = y + radius * sinf(angle);
-    }
-
-    GLuint vao, vbo;
-    glGenVertexArrays(1, &vao);
-    glGenBuffers(1, &vbo);
-    glBindVertexArray(vao);
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
+static void flush_solid_batch(void) {
+    if (batch.vertex_count == 0 || !shaders.solid_program) {
+        batch.vertex_count = 0;
+        batch.range_count = 0;
+        return;
+    }
+
+    GLsizeiptr bytes = (GLsizeiptr)batch.vertex_count * sizeof(BatchVertex);
+    glBindVertexArray(batch.vao);
+    glBindBuffer(GL_ARRAY_BUFFER, batch.vbo);
+    if (bytes > batch.vbo_capacity) {
+        GLsizeiptr capacity = batch.vbo_capacity ? batch.vbo_capacity : 64 * 1024;
+        while (capacity < bytes) capacity *= 2;
+        glBufferData(GL_ARRAY_BUFFER, capacity, NULL, GL_STREAM_DRAW);
+        batch.vbo_capacity = capacity;
+    } else {
+        // Orphan the previous storage so the driver never stalls on in-flight draws
+        glBufferData(GL_ARRAY_BUFFER, batch.vbo_capacity, NULL, GL_STREAM_DRAW);
+    }
+    glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, batch.vertices);
 
-    glUseProgram(program);
-    glUniformMatrix4fv(glGetUniformLocation(program, "projection"), 1, GL_FALSE, ortho);
-    glUniform3f(glGetUniformLocation(program, "color"), r, g, b);
-    glDrawArrays(GL_TRIANGLE_FAN, 0, segments + 2);
+    glUseProgram(shaders.solid_program);
+    for (int i = 0; i < batch.range_count; i++) {
+        glDrawArrays(batch.ranges[i].mode, batch.ranges[i].first, batch.ranges[i].count);
+    }
+    glBindVertexArray(0);
 
-    glDeleteVertexArrays(1, &vao);
-    glDeleteBuffers(1, &vbo);
-    glDeleteProgram(program);
+    batch.vertex_count = 0;
+    batch.range_count = 0;
 }
 
-void render_line(float x1, float y1, float x2, float y2, float r, float g, float b, SDL_Window *window, float cam_x, float cam_y, float cam_scale) {
-    GLuint program = create_shader_program(vertexShaderSource, fragmentShaderSource);
-    if (!program) return;
+void render_flush(void) {
+    // Lines and loose primitives first, then node bodies, connectors, and labels on top
+    flush_solid_batch();
+    if (shaders.instance_program && (node_instances.count > 0 || connector_instances.count > 0)) {
+        glUseProgram(shaders.instance_program);
+        flush_instance_list(&node_instances);
+        flush_instance_list(&connector_instances);
+        glBindVertexArray(0);
+    }
+    node_instances.count = 0;
+    connector_instances.count = 0;
+    flush_text_batch();
+}
 
-    int win_width, win_height;
-    SDL_GetWindowSize(window, &win_width, &win_height);
-    float ortho[16] = {
-        2.0f * cam_scale / win_width, 0.0f, 0.0f, 0.0f,
-        0.0f, -2.0f * cam_scale / win_height, 0.0f, 0.0f,
-        0.0f, 0.0f, 1.0f, 0.0f,
-        -cam_x * 2.0f * cam_scale / win_width - 1.0f, cam_y * 2.0f * cam_scale / win_height + 1.0f, 0.0f, 1.0f
-    };
+void render_push_node(float x, float y, float size, float corner_radius, float r, float g, float b, unsigned int flags) {
+    push_instance(&node_instances, x, y, size, corner_radius, r, g, b, flags | RENDER_INSTANCE_SHAPE(RENDER_SHAPE_ROUNDED_RECT));
+}
 
-    float vertices[] = { x1, y1, x2, y2 };
+void render_push_connector(float x, float y, float radius, float r, float g, float b, unsigned int flags) {
+    push_instance(&connector_instances, x, y, radius, 0.0f, r, g, b, flags | RENDER_INSTANCE_SHAPE(RENDER_SHAPE_CIRCLE));
+}
 
-    GLuint vao, vbo;
-    glGenVertexArrays(1, &vao);
-    glGenBuffers(1, &vbo);
-    glBindVertexArray(vao);
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
+void render_push_ring(float x, float y, float radius, float thickness, float r, float g, float b, unsigned int flags) {
+    push_instance(&connector_instances, x, y, radius, thickness, r, g, b, flags | RENDER_INSTANCE_SHAPE(RENDER_SHAPE_RING));
+}
 
-    glUseProgram(program);
-    glUniformMatrix4fv(glGetUniformLocation(program, "projection"), 1, GL_FALSE, ortho);
-    glUniform3f(glGetUniformLocation(program, "color"), r, g, b);
-    glDrawArrays(GL_LINES, 0, 2);
+void render_push_quad(float x1, float y1, float x2, float y2, float r, float g, float b, float a) {
+    BatchVertex *v = batch_reserve(GL_TRIANGLES, 6);
+    if (!v) return;
+    v[0] = batch_vertex(x1, y1, r, g, b, a);
+    v[1] = batch_vertex(x2, y1, r, g, b, a);
+    v[2] = batch_vertex(x2, y2, r, g, b, a);
+    v[3] = v[2];
+    v[4] = batch_vertex(x1, y2, r, g, b, a);
+    v[5] = v[0];
+}
 
-    glDeleteVertexArrays(1, &vao);
-    glDeleteBuffers(1, &vbo);
-    glDeleteProgram(program);
+void render_push_fan(const float *points, int point_count, float r, float g, float b, float a) {
+    // points[0..1] is the fan center, followed by the rim; emitted as a triangle list
+    if (point_count < 3) return;
+    int triangles = point_count - 2;
+    BatchVertex *v = batch_reserve(GL_TRIANGLES, triangles * 3);
+    if (!v) return;
+    BatchVertex center = batch_vertex(points[0], points[1], r, g, b, a);
+    for (int i = 0; i < triangles; i++) {
+        const float *p = &points[(i + 1) * 2];
+        *v++ = center;
+        *v++ = batch_vertex(p[0], p[1], r, g, b, a);
+        *v++ = batch_vertex(p[2], p[3], r, g, b, a);
+    }
 }
 
-void render_text(const char *text, float x, float y, TTF_Font *font, SDL_Window *window, float cam_x, float cam_y, float cam_scale) {
-    if (!text || strlen(text) == 0) return;
+void render_push_line(float x1, float y1, float x2, float y2, float r, float g, float b, float a) {
+    BatchVertex *v = batch_reserve(GL_LINES, 2);
+    if (!v) return;
+    v[0] = batch_vertex(x1, y1, r, g, b, a);
+    v[1] = batch_vertex(x2, y2, r, g, b, a);
+}
 
-    SDL_Color text_color = {255, 255, 255, 255};
-    SDL_Color bg_color = {50, 50, 50, 200};
-    SDL_Surface *text_surface = TTF_RenderText_Shaded(font, text, strlen(text), text_color, bg_color);
-    if (!text_surface) {
-        SDL_Log("TTF_RenderText_Shaded failed: %s", SDL_GetError());
-        return;
-    }
+void render_square(float x, float y, float size, float r, float g, float b) {
+    float half_size = size / 2.0f;
+    render_push_quad(x - half_size, y - half_size, x + half_size, y + half_size, r, g, b, 1.0f);
+}
 
-    SDL_Surface *converted_surface = SDL_ConvertSurface(text_surface, SDL_PIXELFORMAT_RGBA32);
-    SDL_DestroySurface(text_surface);
-    if (!converted_surface) {
-        SDL_Log("SDL_ConvertSurface failed: %s", SDL_GetError());
-        return;
-    }
+void render_circle(float x, float y, float radius, float r, float g, float b) {
+    render_push_connector(x, y, radius, r, g, b, 0);
+}
 
-    GLuint texture;
-    glGenTextures(1, &texture);
-    glBindTexture(GL_TEXTURE_2D, texture);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, converted_surface->w, converted_surface->h, 0, GL_RGBA, GL_UNSIGNED_BYTE, converted_surface->pixels);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+void render_line(float x1, float y1, float x2, float y2, float r, float g, float b) {
+    render_push_line(x1, y1, x2, y2, r, g, b, 1.0f);
+}
 
-    int win_width, win_height;
-    SDL_GetWindowSize(window, &win_width, &win_height);
-    float ortho[16] = {
-        2.0f * cam_scale / win_width, 0.0f, 0.0f, 0.0f,
-        0.0f, -2.0f * cam_scale / win_height, 0.0f, 0.0f,
-        0.0f, 0.0f, 1.0f, 0.0f,
-        -cam_x * 2.0f * cam_scale / win_width - 1.0f, cam_y * 2.0f * cam_scale / win_height + 1.0f, 0.0f, 1.0f
-    };
+// Kerning adjustment between two adjacent codepoints; 0 for the first glyph of a string
+static int glyph_kerning(TTF_Font *font, Uint32 previous, Uint32 codepoint) {
+    int kerning = 0;
+    if (previous == 0 || !TTF_GetGlyphKerning(font, previous, codepoint, &kerning)) {
+        return 0;
+    }
+    return kerning;
+}
 
-    GLuint program = create_shader_program(textVertexShaderSource, textFragmentShaderSource);
-    if (!program) {
-        glDeleteTextures(1, &texture);
-        SDL_DestroySurface(converted_surface);
-        return;
+bool render_measure_text(const char *text, TTF_Font *font, int *w, int *h) {
+    if (!text || !font) return false;
+    int width = 0;
+    size_t len = strlen(text);
+    const char *p = text;
+    Uint32 previous = 0;
+    while (len > 0) {
+        Uint32 codepoint = SDL_StepUTF8(&p, &len);
+        if (codepoint == 0) break;
+        const Glyph *glyph = atlas_get_glyph(font, codepoint);
+        if (!glyph) continue;
+        width += glyph_kerning(font, previous, codepoint) + glyph->advance;
+        previous = codepoint;
     }
+    if (atlas.font != font) atlas_reset(font);
+    *w = width;
+    *h = atlas.line_height;
+    return true;
+}
 
-    float w = (float)converted_surface->w;
-    float h = (float)converted_surface->h;
-    float vertices[] = {
-        x, y, 0.0f, 0.0f,
-        x + w, y, 1.0f, 0.0f,
-        x + w, y + h, 1.0f, 1.0f,
-        x, y + h, 0.0f, 1.0f
-    };
-    unsigned int indices[] = { 0, 1, 2, 2, 3, 0 };
-
-    GLuint vao, vbo, ebo;
-    glGenVertexArrays(1, &vao);
-    glGenBuffers(1, &vbo);
-    glGenBuffers(1, &ebo);
-    glBindVertexArray(vao);
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
-    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(2 * sizeof(float)));
-    glEnableVertexAttribArray(1);
+void render_text(const char *text, float x, float y, TTF_Font *font) {
+    if (!text || text[0] == '\0' || !font) return;
 
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    glUseProgram(program);
-    glUniformMatrix4fv(glGetUniformLocation(program, "projection"), 1, GL_FALSE, ortho);
-    glUniform1i(glGetUniformLocation(program, "textTexture"), 0);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, texture);
-    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
-
-    glDeleteVertexArrays(1, &vao);
-    glDeleteBuffers(1, &vbo);
-    glDeleteBuffers(1, &ebo);
-    glDeleteTextures(1, &texture);
-    glDeleteProgram(program);
-    SDL_DestroySurface(converted_surface);
-}
\ No newline at end of file
+    SDL_Color text_color = {255, 255, 255, 255};
+    SDL_Color bg_color = {50, 50, 50, 200};
+
+    // Background panel sampled from the opaque block at the atlas origin
+    int w, h;
+    render_measure_text(text, font, &w, &h);
+    const float white = ATLAS_WHITE_SIZE * 0.5f;
+    text_push_quad(x, y, x + w, y + h, white, white, white, white, bg_color);
+
+    float pen_x = x;
+    size_t len = strlen(text);
+    const char *p = text;
+    Uint32 previous = 0;
+    while (len > 0) {
+        Uint32 codepoint = SDL_StepUTF8(&p, &len);
+        if (codepoint == 0) break;
+        const Glyph *glyph = atlas_get_glyph(font, codepoint);
+        if (!glyph) continue;
+        pen_x += glyph_kerning(font, previous, codepoint);
+        previous = codepoint;
+        if (glyph->w > 0) {
+            text_push_quad(pen_x, y, pen_x + glyph->w, y + glyph->h,
+                           glyph->x, glyph->y, glyph->x + glyph->w, glyph->y + glyph->h, text_color);
+        }
+        pen_x += glyph->advance;
+    }
+}
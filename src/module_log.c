@@ -0,0 +1,179 @@
+#include "module_log.h"
+#include <SDL3/SDL.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdbool.h>
+
+// Bounded multi-producer ring (Vyukov): each slot carries a sequence number that
+// tells producers when it is free and the writer thread when it is published,
+// so logging from any thread takes no lock and does no I/O.
+enum {
+    LOG_RING_SIZE = 1024, // power of two
+    LOG_RING_MASK = LOG_RING_SIZE - 1,
+    LOG_MESSAGE_SIZE = 240,
+    LOG_WRITER_INTERVAL_MS = 5
+};
+
+typedef struct {
+    SDL_AtomicU32 sequence;
+    Uint64 timestamp_ns;
+    unsigned char level;
+    unsigned char category;
+    char message[LOG_MESSAGE_SIZE];
+} LogSlot;
+
+typedef struct {
+    LogSlot slots[LOG_RING_SIZE];
+    SDL_AtomicU32 head;     // next slot producers claim
+    Uint32 tail;            // next slot the writer reads (writer thread only)
+    SDL_AtomicInt dropped;
+    SDL_AtomicInt running;
+    SDL_Semaphore *wake;
+    SDL_Thread *writer;
+} LogRing;
+
+static LogRing ring;
+
+unsigned char log_category_levels[LOG_CATEGORY_COUNT] = {
+    LOG_LEVEL_INFO, LOG_LEVEL_INFO, LOG_LEVEL_INFO, LOG_LEVEL_INFO, LOG_LEVEL_INFO
+};
+
+static const char *level_names[] = { "TRACE", "DEBUG", "INFO", "WARN", "ERROR", "OFF" };
+static const char *category_names[] = { "general", "input", "render", "lua", "eval" };
+
+static void write_line(Uint64 timestamp_ns, int level, int category, const char *message) {
+    fprintf(stdout, "[%10.4f] %-5s %-7s %s\n", timestamp_ns / 1e9, level_names[level], category_names[category], message);
+}
+
+// Write every published slot; returns the number of messages written
+static int drain_ring(void) {
+    int written = 0;
+    for (;;) {
+        LogSlot *slot = &ring.slots[ring.tail & LOG_RING_MASK];
+        Uint32 sequence = SDL_GetAtomicU32(&slot->sequence);
+        if ((Sint32)(sequence - (ring.tail + 1)) != 0) break;
+        write_line(slot->timestamp_ns, slot->level, slot->category, slot->message);
+        SDL_SetAtomicU32(&slot->sequence, ring.tail + LOG_RING_SIZE);
+        ring.tail++;
+        written++;
+    }
+    if (written > 0) fflush(stdout);
+    return written;
+}
+
+static int writer_thread(void *data) {
+    (void)data;
+    while (SDL_GetAtomicInt(&ring.running)) {
+        if (drain_ring() == 0) {
+            SDL_WaitSemaphoreTimeout(ring.wake, LOG_WRITER_INTERVAL_MS);
+        }
+    }
+    drain_ring();
+    return 0;
+}
+
+bool log_init(void) {
+    if (ring.writer) return true;
+    for (Uint32 i = 0; i < LOG_RING_SIZE; i++) {
+        SDL_SetAtomicU32(&ring.slots[i].sequence, i);
+    }
+    SDL_SetAtomicU32(&ring.head, 0);
+    SDL_SetAtomicInt(&ring.dropped, 0);
+    ring.tail = 0;
+    ring.wake = SDL_CreateSemaphore(0);
+    if (!ring.wake) {
+        fprintf(stdout, "Failed to create log semaphore: %s\n", SDL_GetError());
+        return false;
+    }
+    SDL_SetAtomicInt(&ring.running, 1);
+    ring.writer = SDL_CreateThread(writer_thread, "log_writer", NULL);
+    if (!ring.writer) {
+        fprintf(stdout, "Failed to create log writer thread: %s\n", SDL_GetError());
+        SDL_SetAtomicInt(&ring.running, 0);
+        SDL_DestroySemaphore(ring.wake);
+        ring.wake = NULL;
+        return false;
+    }
+    return true;
+}
+
+void log_shutdown(void) {
+    if (!ring.writer) return;
+    SDL_SetAtomicInt(&ring.running, 0);
+    SDL_SignalSemaphore(ring.wake);
+    SDL_WaitThread(ring.writer, NULL);
+    ring.writer = NULL;
+    SDL_DestroySemaphore(ring.wake);
+    ring.wake = NULL;
+    unsigned int dropped = (unsigned int)SDL_GetAtomicInt(&ring.dropped);
+    if (dropped > 0) {
+        fprintf(stdout, "Log ring overflowed, %u messages dropped\n", dropped);
+        fflush(stdout);
+    }
+}
+
+void log_set_level(LogCategory category, int level) {
+    if (category < 0 || category >= LOG_CATEGORY_COUNT) return;
+    log_category_levels[category] = (unsigned char)SDL_clamp(level, LOG_LEVEL_TRACE, LOG_LEVEL_OFF);
+}
+
+void log_set_all_levels(int level) {
+    for (int i = 0; i < LOG_CATEGORY_COUNT; i++) {
+        log_set_level((LogCategory)i, level);
+    }
+}
+
+int log_level_from_string(const char *name, int default_level) {
+    if (!name) return default_level;
+    for (int i = LOG_LEVEL_TRACE; i <= LOG_LEVEL_OFF; i++) {
+        if (SDL_strcasecmp(name, level_names[i]) == 0) return i;
+    }
+    if (SDL_strcasecmp(name, "warning") == 0) return LOG_LEVEL_WARN;
+    return default_level;
+}
+
+unsigned int log_dropped_count(void) {
+    return (unsigned int)SDL_GetAtomicInt(&ring.dropped);
+}
+
+void log_write(LogCategory category, int level, const char *fmt, ...) {
+    if (category < 0 || category >= LOG_CATEGORY_COUNT || level < LOG_LEVEL_TRACE || level >= LOG_LEVEL_OFF) return;
+    va_list args;
+
+    if (!SDL_GetAtomicInt(&ring.running)) {
+        // No writer thread yet (or anymore): write straight through
+        char message[LOG_MESSAGE_SIZE];
+        va_start(args, fmt);
+        vsnprintf(message, sizeof(message), fmt, args);
+        va_end(args);
+        write_line(SDL_GetTicksNS(), level, category, message);
+        fflush(stdout);
+        return;
+    }
+
+    // Claim a slot; a full ring drops the message rather than blocking the caller
+    Uint32 position = SDL_GetAtomicU32(&ring.head);
+    LogSlot *slot;
+    for (;;) {
+        slot = &ring.slots[position & LOG_RING_MASK];
+        Uint32 sequence = SDL_GetAtomicU32(&slot->sequence);
+        Sint32 diff = (Sint32)(sequence - position);
+        if (diff == 0) {
+            if (SDL_CompareAndSwapAtomicU32(&ring.head, position, position + 1)) break;
+            position = SDL_GetAtomicU32(&ring.head);
+        } else if (diff < 0) {
+            SDL_AddAtomicInt(&ring.dropped, 1);
+            return;
+        } else {
+            position = SDL_GetAtomicU32(&ring.head);
+        }
+    }
+
+    slot->timestamp_ns = SDL_GetTicksNS();
+    slot->level = (unsigned char)level;
+    slot->category = (unsigned char)category;
+    va_start(args, fmt);
+    vsnprintf(slot->message, sizeof(slot->message), fmt, args);
+    va_end(args);
+    SDL_SetAtomicU32(&slot->sequence, position + 1); // publish to the writer
+}
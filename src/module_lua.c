@@ -1,123 +1,1038 @@
 #include "module_lua.h"
+#include "module_log.h"
+#include "module_alloc.h"
 #include <lua.h>
 #include <lauxlib.h>
 #include <lualib.h>
+#include <SDL3/SDL.h>
 #include <string.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <stdbool.h> // Added to define bool, true, false
 
+// Globals the editor reads every frame. They live in registry references rather than
+// in _G; a metatable on _G routes script reads and assignments to those references.
+// Only the references are cached, since __newindex cannot see edits inside a table:
+// config is read live on every access, and nodes and connections are views of C stores
+// whose writes go through metamethods.
+enum {
+    TRACKED_CONFIG,
+    TRACKED_NODES,
+    TRACKED_CONNECTIONS,
+    TRACKED_ON_FRAME,
+    TRACKED_COUNT
+};
+static const char *tracked_names[TRACKED_COUNT] = { "config", "nodes", "connections", "on_frame" };
+
+// Field names interned once; short Lua strings are unique, so a key read back from a
+// table can be matched against these by address
+enum {
+    KEY_X, KEY_Y, KEY_SIZE, KEY_R, KEY_G, KEY_B, KEY_INPUTS, KEY_OUTPUTS, KEY_TEXT, KEY_ID, KEY_KERNEL, KEY_VALUE,
+    KEY_FROM_NODE, KEY_FROM_OUTPUT, KEY_TO_NODE, KEY_TO_INPUT,
+    KEY_COUNT
+};
+static const char *key_names[KEY_COUNT] = {
+    "x", "y", "size", "r", "g", "b", "inputs", "outputs", "text", "id", "kernel", "value",
+    "from_node", "from_output", "to_node", "to_input"
+};
+_Static_assert((int)KEY_X == (int)LUA_NODE_FIELD_X && (int)KEY_VALUE + 1 == (int)LUA_NODE_FIELD_COUNT,
+               "node keys must line up with LuaNodeField");
+
+// Edge indices touching one node; order is not preserved on removal
+typedef struct {
+    int *edges;
+    int count;
+    int capacity;
+} EdgeList;
+
+// The connections, which scripts see as connections[i] = edges[i - 1]. Each edge records
+// where it sits in its endpoints' adjacency lists so removal is O(1) per edge. Lists are
+// keyed by node id, which survives deletion of other nodes, through a hash table, so
+// memory follows the number of connected nodes rather than the largest id.
+typedef struct {
+    LuaConnection *edges;
+    int *in_slot;           // position in the to_node's incoming list, -1 when not indexed
+    int *out_slot;          // position in the from_node's outgoing list, -1 when not indexed
+    int count;
+    int capacity;
+    EdgeList *incoming;     // per connected node, edges ending at it
+    EdgeList *outgoing;     // per connected node, edges starting from it
+    int *list_ids;          // node id owning each pair of lists
+    int list_count;         // lists in use since the last clear
+    int list_capacity;
+    int *id_slots;          // open-addressing table of list positions by node id, -1 when empty
+    int id_slot_mask;       // table size - 1; the size is a power of two, at most half full
+} ConnectionStore;
+
+#define CONNECTIONS_METATABLE "lua_utils.connections"
+#define CONNECTION_METATABLE "lua_utils.connection"
+
+// Registry slot keeping the last string returned by lua_utils_get_node_text alive
+static const char *TEXT_ANCHOR_KEY = "lua_utils.text_anchor";
+
+typedef struct {
+    int table_refs[TRACKED_COUNT]; // LUA_NOREF while the global is nil
+    int key_refs[KEY_COUNT];
+    const char *keys[KEY_COUNT];   // interned addresses, pinned by key_refs
+    bool redraw_requested;
+    LuaPath animate_path;          // config.animate, read live so scripts can toggle it
+    ConnectionStore connections;
+    bool nodes_replaced;           // nodes global was reassigned since the last check
+    LuaConnectionListener connection_listener;
+    void *connection_listener_user;
+    AllocPool *pool;               // backs every allocation of the state; outlives it
+    Uint64 gc_budget_ns;           // per-frame step budget; 0 leaves collection automatic
+    int gc_pause;                  // percent growth over gc_baseline_kb before a new cycle
+    int gc_baseline_kb;            // heap size when the last manual cycle finished
+    bool gc_in_cycle;              // a manual cycle started and LUA_GCSTEP has not finished it
+} LuaUtilsContext;
+
+// The context pointer sits in the state's extra space, one pointer ahead of lua_State
+static LuaUtilsContext* get_context(lua_State *L) {
+    return *(LuaUtilsContext**)lua_getextraspace(L);
+}
+
+static int tracked_index(const char *name) {
+    for (int i = 0; i < TRACKED_COUNT; i++) {
+        if (strcmp(name, tracked_names[i]) == 0) return i;
+    }
+    return -1;
+}
+
+// Push a tracked global; returns its type like lua_getglobal
+static int push_tracked(lua_State *L, int tracked) {
+    return lua_rawgeti(L, LUA_REGISTRYINDEX, get_context(L)->table_refs[tracked]);
+}
+
+static void replace_connections(lua_State *L);
+
+// Pop the top value into a tracked global, replacing the old reference. The connections
+// global keeps its view; what is assigned to it only replaces the indexed connections.
+static void set_tracked(lua_State *L, int tracked) {
+    LuaUtilsContext *context = get_context(L);
+    if (tracked == TRACKED_CONNECTIONS) {
+        replace_connections(L);
+        return;
+    } else if (tracked == TRACKED_NODES) {
+        context->nodes_replaced = true;
+    }
+    luaL_unref(L, LUA_REGISTRYINDEX, context->table_refs[tracked]);
+    if (lua_isnil(L, -1)) {
+        lua_pop(L, 1);
+        context->table_refs[tracked] = LUA_NOREF;
+    } else {
+        context->table_refs[tracked] = luaL_ref(L, LUA_REGISTRYINDEX);
+    }
+}
+
+static int push_global_table(lua_State *L, const char *name) {
+    int tracked = tracked_index(name);
+    return tracked >= 0 ? push_tracked(L, tracked) : lua_getglobal(L, name);
+}
+
+static void set_global_table(lua_State *L, const char *name) {
+    int tracked = tracked_index(name);
+    if (tracked >= 0) {
+        set_tracked(L, tracked);
+    } else {
+        lua_setglobal(L, name);
+    }
+}
+
+// Push an interned field name
+static void push_key(lua_State *L, int key) {
+    lua_rawgeti(L, LUA_REGISTRYINDEX, get_context(L)->key_refs[key]);
+}
+
+// Read an integer field through its interned key (0 when missing)
+static int get_key_integer(lua_State *L, int table, int key) {
+    table = lua_absindex(L, table);
+    push_key(L, key);
+    lua_rawget(L, table);
+    int value = lua_isnumber(L, -1) ? (int)lua_tointeger(L, -1) : 0;
+    lua_pop(L, 1);
+    return value;
+}
+
+// Setters go through __newindex so they also reach node proxies
+static void set_key_integer(lua_State *L, int table, int key, lua_Integer value) {
+    table = lua_absindex(L, table);
+    push_key(L, key);
+    lua_pushinteger(L, value);
+    lua_settable(L, table);
+}
+
+static void set_key_number(lua_State *L, int table, int key, lua_Number value) {
+    table = lua_absindex(L, table);
+    push_key(L, key);
+    lua_pushnumber(L, value);
+    lua_settable(L, table);
+}
+
+static bool edge_list_push(EdgeList *list, int edge, int *slot) {
+    if (list->count == list->capacity) {
+        int capacity = list->capacity ? list->capacity * 2 : 4;
+        int *edges = realloc(list->edges, capacity * sizeof(int));
+        if (!edges) return false;
+        list->edges = edges;
+        list->capacity = capacity;
+    }
+    *slot = list->count;
+    list->edges[list->count++] = edge;
+    return true;
+}
+
+static void store_free(ConnectionStore *store) {
+    for (int i = 0; i < store->list_capacity; i++) {
+        free(store->incoming[i].edges);
+        free(store->outgoing[i].edges);
+    }
+    free(store->incoming);
+    free(store->outgoing);
+    free(store->list_ids);
+    free(store->id_slots);
+    free(store->edges);
+    free(store->in_slot);
+    free(store->out_slot);
+    memset(store, 0, sizeof(*store));
+}
+
+// Drop every edge and list; the list buffers are kept for reuse
+static void store_clear(ConnectionStore *store) {
+    store->count = 0;
+    store->list_count = 0;
+    if (store->id_slots) {
+        memset(store->id_slots, -1, (store->id_slot_mask + 1) * sizeof(int));
+    }
+}
+
+static unsigned int id_hash(int id) {
+    unsigned int hash = (unsigned int)id * 2654435761u;
+    return hash ^ (hash >> 16);
+}
+
+// Position of a node's edge lists, or -1 when it has none
+static int node_lists(const ConnectionStore *store, int node_id) {
+    if (!store->id_slots) return -1;
+    unsigned int mask = (unsigned int)store->id_slot_mask;
+    for (unsigned int slot = id_hash(node_id) & mask; ; slot = (slot + 1) & mask) {
+        int list = store->id_slots[slot];
+        if (list < 0 || store->list_ids[list] == node_id) return list;
+    }
+}
+
+static void insert_id_slot(ConnectionStore *store, int list) {
+    unsigned int mask = (unsigned int)store->id_slot_mask;
+    unsigned int slot = id_hash(store->list_ids[list]) & mask;
+    while (store->id_slots[slot] >= 0) slot = (slot + 1) & mask;
+    store->id_slots[slot] = list;
+}
+
+static bool grow_id_slots(ConnectionStore *store) {
+    int size = store->id_slots ? (store->id_slot_mask + 1) * 2 : 128;
+    int *id_slots = malloc(size * sizeof(int));
+    if (!id_slots) return false;
+    memset(id_slots, -1, size * sizeof(int));
+    free(store->id_slots);
+    store->id_slots = id_slots;
+    store->id_slot_mask = size - 1;
+    for (int list = 0; list < store->list_count; list++) {
+        insert_id_slot(store, list);
+    }
+    return true;
+}
+
+// Position of a node's edge lists, adding empty ones for a node seen the first time;
+// -1 when out of memory
+static int claim_node_lists(ConnectionStore *store, int node_id) {
+    int list = node_lists(store, node_id);
+    if (list >= 0) return list;
+    if (store->list_count == store->list_capacity) {
+        int capacity = store->list_capacity ? store->list_capacity * 2 : 64;
+        EdgeList *incoming = realloc(store->incoming, capacity * sizeof(EdgeList));
+        if (!incoming) return -1;
+        store->incoming = incoming;
+        EdgeList *outgoing = realloc(store->outgoing, capacity * sizeof(EdgeList));
+        if (!outgoing) return -1;
+        store->outgoing = outgoing;
+        int *list_ids = realloc(store->list_ids, capacity * sizeof(int));
+        if (!list_ids) return -1;
+        store->list_ids = list_ids;
+        memset(store->incoming + store->list_capacity, 0, (capacity - store->list_capacity) * sizeof(EdgeList));
+        memset(store->outgoing + store->list_capacity, 0, (capacity - store->list_capacity) * sizeof(EdgeList));
+        store->list_capacity = capacity;
+    }
+    if ((store->list_count + 1) * 2 > (store->id_slots ? store->id_slot_mask + 1 : 0) && !grow_id_slots(store)) {
+        return -1;
+    }
+    list = store->list_count++;
+    store->list_ids[list] = node_id;
+    store->incoming[list].count = 0;
+    store->outgoing[list].count = 0;
+    insert_id_slot(store, list);
+    return list;
+}
+
+static int store_add(ConnectionStore *store, const LuaConnection *connection) {
+    if (store->count == store->capacity) {
+        int capacity = store->capacity ? store->capacity * 2 : 256;
+        LuaConnection *edges = realloc(store->edges, capacity * sizeof(LuaConnection));
+        if (!edges) return -1;
+        store->edges = edges;
+        int *in_slot = realloc(store->in_slot, capacity * sizeof(int));
+        if (!in_slot) return -1;
+        store->in_slot = in_slot;
+        int *out_slot = realloc(store->out_slot, capacity * sizeof(int));
+        if (!out_slot) return -1;
+        store->out_slot = out_slot;
+        store->capacity = capacity;
+    }
+    int edge = store->count;
+    int from_node = connection->from_node, to_node = connection->to_node;
+    int highest = from_node > to_node ? from_node : to_node;
+    store->in_slot[edge] = -1;
+    store->out_slot[edge] = -1;
+    if (from_node > 0 && to_node > 0 && highest <= LUA_NODE_ID_MAX) {
+        int from_list = claim_node_lists(store, from_node);
+        int to_list = from_list < 0 ? -1 : claim_node_lists(store, to_node);
+        if (to_list < 0 || !edge_list_push(&store->outgoing[from_list], edge, &store->out_slot[edge])) {
+            return -1;
+        }
+        if (!edge_list_push(&store->incoming[to_list], edge, &store->in_slot[edge])) {
+            store->outgoing[from_list].count--;
+            return -1;
+        }
+    }
+    store->edges[edge] = *connection;
+    store->count++;
+    return edge;
+}
+
+// Point the adjacency entries of edge `from` at index `to`
+static void store_move_edge(ConnectionStore *store, int from, int to) {
+    const LuaConnection *connection = &store->edges[from];
+    if (store->out_slot[from] >= 0) {
+        store->outgoing[node_lists(store, connection->from_node)].edges[store->out_slot[from]] = to;
+    }
+    if (store->in_slot[from] >= 0) {
+        store->incoming[node_lists(store, connection->to_node)].edges[store->in_slot[from]] = to;
+    }
+    store->edges[to] = store->edges[from];
+    store->in_slot[to] = store->in_slot[from];
+    store->out_slot[to] = store->out_slot[from];
+}
+
+static void edge_list_remove(ConnectionStore *store, EdgeList *list, int slot, bool incoming) {
+    int moved = list->edges[--list->count];
+    if (slot == list->count) return;
+    list->edges[slot] = moved;
+    if (incoming) {
+        store->in_slot[moved] = slot;
+    } else {
+        store->out_slot[moved] = slot;
+    }
+}
+
+// Swap-remove edge; the previous last edge takes its index
+static void store_remove(ConnectionStore *store, int edge) {
+    const LuaConnection *connection = &store->edges[edge];
+    if (store->out_slot[edge] >= 0) {
+        edge_list_remove(store, &store->outgoing[node_lists(store, connection->from_node)], store->out_slot[edge], false);
+    }
+    if (store->in_slot[edge] >= 0) {
+        edge_list_remove(store, &store->incoming[node_lists(store, connection->to_node)], store->in_slot[edge], true);
+    }
+    int last = --store->count;
+    if (edge != last) {
+        store_move_edge(store, last, edge);
+    }
+}
+
+// The store is the only copy of the connections; scripts see it through the view below
+static ConnectionStore* get_connection_store(lua_State *L) {
+    return &get_context(L)->connections;
+}
+
+static void notify_connection(lua_State *L, const LuaConnection *connection, bool added) {
+    LuaUtilsContext *context = get_context(L);
+    if (context->connection_listener) {
+        context->connection_listener(context->connection_listener_user, connection, added);
+    }
+}
+
+// Pop the value assigned to the connections global: a table replaces every connection
+// (anything else clears them), and the view stays in place
+static void replace_connections(lua_State *L) {
+    if (luaL_testudata(L, -1, CONNECTIONS_METATABLE)) {
+        lua_pop(L, 1); // the view assigned back to itself
+        return;
+    }
+    ConnectionStore *store = get_connection_store(L);
+    store_clear(store);
+    int count = lua_istable(L, -1) ? (int)lua_rawlen(L, -1) : 0;
+    for (int i = 1; i <= count; i++) {
+        LuaConnection connection = { 0, 0, 0, 0 };
+        if (lua_rawgeti(L, -1, i) == LUA_TTABLE) {
+            connection.from_node = get_key_integer(L, -1, KEY_FROM_NODE);
+            connection.from_output = get_key_integer(L, -1, KEY_FROM_OUTPUT);
+            connection.to_node = get_key_integer(L, -1, KEY_TO_NODE);
+            connection.to_input = get_key_integer(L, -1, KEY_TO_INPUT);
+        }
+        lua_pop(L, 1);
+        if (store_add(store, &connection) < 0) {
+            LOG_ERROR(LOG_CATEGORY_LUA, "Failed to index connection %d of %d", i, count);
+            break;
+        }
+    }
+    lua_pop(L, 1);
+    notify_connection(L, NULL, true);
+}
+
+// Swap-remove an edge; the previous last edge takes its index
+static void remove_connection_at(lua_State *L, ConnectionStore *store, int edge) {
+    LuaConnection removed = store->edges[edge];
+    notify_connection(L, &removed, false);
+    store_remove(store, edge);
+}
+
+// The connections global: a read-only view of the store. connections[i] is a read-only
+// copy of one edge, so edits cannot bypass the adjacency lists; scripts change the
+// graph with add_connection and remove_connection.
+static int l_connections_index(lua_State *L) {
+    ConnectionStore *store = get_connection_store(L);
+    lua_Integer i = lua_isinteger(L, 2) ? lua_tointeger(L, 2) : 0;
+    if (i < 1 || i > store->count) {
+        lua_pushnil(L);
+        return 1;
+    }
+    LuaConnection *connection = lua_newuserdatauv(L, sizeof(LuaConnection), 0);
+    *connection = store->edges[i - 1];
+    luaL_setmetatable(L, CONNECTION_METATABLE);
+    return 1;
+}
+
+static int l_connections_len(lua_State *L) {
+    lua_pushinteger(L, get_connection_store(L)->count);
+    return 1;
+}
+
+static int l_connections_newindex(lua_State *L) {
+    return luaL_error(L, "connections are read-only; use add_connection and remove_connection");
+}
+
+static int l_connection_index(lua_State *L) {
+    const LuaConnection *connection = luaL_checkudata(L, 1, CONNECTION_METATABLE);
+    const char *key = lua_type(L, 2) == LUA_TSTRING ? lua_tostring(L, 2) : NULL;
+    const char **keys = get_context(L)->keys;
+    if (key == keys[KEY_FROM_NODE]) lua_pushinteger(L, connection->from_node);
+    else if (key == keys[KEY_FROM_OUTPUT]) lua_pushinteger(L, connection->from_output);
+    else if (key == keys[KEY_TO_NODE]) lua_pushinteger(L, connection->to_node);
+    else if (key == keys[KEY_TO_INPUT]) lua_pushinteger(L, connection->to_input);
+    else lua_pushnil(L);
+    return 1;
+}
+
+// add_connection(from_node, from_output, to_node, to_input), node ids and 1-based connectors
+static int l_add_connection(lua_State *L) {
+    lua_utils_add_connection(L, (int)luaL_checkinteger(L, 1), (int)luaL_checkinteger(L, 2),
+                             (int)luaL_checkinteger(L, 3), (int)luaL_checkinteger(L, 4));
+    return 0;
+}
+
+// remove_connection(from_node, from_output, to_node, to_input): true when one was removed
+static int l_remove_connection(lua_State *L) {
+    LuaConnection connection = {
+        (int)luaL_checkinteger(L, 1), (int)luaL_checkinteger(L, 2),
+        (int)luaL_checkinteger(L, 3), (int)luaL_checkinteger(L, 4)
+    };
+    lua_pushboolean(L, lua_utils_remove_connection(L, &connection));
+    return 1;
+}
+
+// _G.__index: only reached for names missing from _G, which includes every tracked global
+static int l_globals_index(lua_State *L) {
+    const char *name = lua_type(L, 2) == LUA_TSTRING ? lua_tostring(L, 2) : NULL;
+    int tracked = name ? tracked_index(name) : -1;
+    if (tracked < 0) {
+        lua_pushnil(L);
+        return 1;
+    }
+    push_tracked(L, tracked);
+    return 1;
+}
+
+// _G.__newindex: assignments to tracked globals refresh the cached reference. Nothing
+// derived from a table's contents may be cached here; this only runs on reassignment.
+static int l_globals_newindex(lua_State *L) {
+    const char *name = lua_type(L, 2) == LUA_TSTRING ? lua_tostring(L, 2) : NULL;
+    int tracked = name ? tracked_index(name) : -1;
+    lua_settop(L, 3);
+    if (tracked < 0) {
+        lua_rawset(L, 1);
+        return 0;
+    }
+    set_tracked(L, tracked);
+    return 0;
+}
+
+// request_redraw(): ask the editor to render another frame
+static int l_request_redraw(lua_State *L) {
+    lua_utils_request_redraw(L);
+    return 0;
+}
+
+// memory_stats(): allocator counters of this state as a table
+static int l_memory_stats(lua_State *L) {
+    AllocStats stats;
+    alloc_pool_get_stats(get_context(L)->pool, &stats);
+    lua_createtable(L, 0, 6);
+    lua_pushinteger(L, (lua_Integer)stats.live_bytes);
+    lua_setfield(L, -2, "live_bytes");
+    lua_pushinteger(L, (lua_Integer)stats.peak_bytes);
+    lua_setfield(L, -2, "peak_bytes");
+    lua_pushinteger(L, (lua_Integer)stats.pool_bytes);
+    lua_setfield(L, -2, "pool_bytes");
+    lua_pushinteger(L, (lua_Integer)stats.total_allocs);
+    lua_setfield(L, -2, "total_allocs");
+    lua_pushinteger(L, (lua_Integer)stats.frame_allocs);
+    lua_setfield(L, -2, "frame_allocs");
+    lua_pushinteger(L, (lua_Integer)stats.frame_bytes);
+    lua_setfield(L, -2, "frame_bytes");
+    return 1;
+}
+
+static int l_panic(lua_State *L) {
+    LOG_ERROR(LOG_CATEGORY_LUA, "Unprotected Lua error: %s", lua_isstring(L, -1) ? lua_tostring(L, -1) : "(error object is not a string)");
+    return 0;
+}
+
+static LuaUtilsContext* create_context(lua_State *L) {
+    LuaUtilsContext *context = calloc(1, sizeof(LuaUtilsContext));
+    if (!context) {
+        return NULL;
+    }
+    *(LuaUtilsContext**)lua_getextraspace(L) = context;
+    for (int i = 0; i < TRACKED_COUNT; i++) {
+        context->table_refs[i] = LUA_NOREF;
+    }
+    for (int i = 0; i < KEY_COUNT; i++) {
+        lua_pushstring(L, key_names[i]);
+        context->keys[i] = lua_tostring(L, -1);
+        context->key_refs[i] = luaL_ref(L, LUA_REGISTRYINDEX);
+    }
+
+    luaL_newmetatable(L, CONNECTIONS_METATABLE);
+    lua_pushcfunction(L, l_connections_index);
+    lua_setfield(L, -2, "__index");
+    lua_pushcfunction(L, l_connections_len);
+    lua_setfield(L, -2, "__len");
+    lua_pushcfunction(L, l_connections_newindex);
+    lua_setfield(L, -2, "__newindex");
+    lua_pop(L, 1);
+    luaL_newmetatable(L, CONNECTION_METATABLE);
+    lua_pushcfunction(L, l_connection_index);
+    lua_setfield(L, -2, "__index");
+    lua_pushcfunction(L, l_connections_newindex);
+    lua_setfield(L, -2, "__newindex");
+    lua_pop(L, 1);
+    lua_newuserdatauv(L, 0, 0);
+    luaL_setmetatable(L, CONNECTIONS_METATABLE);
+    context->table_refs[TRACKED_CONNECTIONS] = luaL_ref(L, LUA_REGISTRYINDEX);
+
+    // Route the tracked globals through the registry before the script assigns them
+    lua_pushglobaltable(L);
+    lua_createtable(L, 0, 2);
+    lua_pushcfunction(L, l_globals_index);
+    lua_setfield(L, -2, "__index");
+    lua_pushcfunction(L, l_globals_newindex);
+    lua_setfield(L, -2, "__newindex");
+    lua_setmetatable(L, -2);
+    lua_pop(L, 1);
+    return context;
+}
+
+// Bytecode cache written next to the script as "<script>.cache": this header, then the
+// lua_dump output. Size and mtime are checked first so a hit never reads the source;
+// when only the mtime moved, the content hash decides. The bytecode itself is hashed too:
+// Lua does not verify binary chunks, so a truncated or corrupted payload must never reach
+// luaL_loadbufferx.
+#define SCRIPT_CACHE_MAGIC "N2DLUAC2"
+typedef struct {
+    char magic[8];
+    Uint32 lua_version;      // LUA_VERSION_NUM of the state that dumped the chunk
+    Uint32 bytecode_size;
+    Uint64 source_size;
+    Sint64 source_mtime;
+    Uint64 source_hash;      // FNV-1a over the source bytes
+    Uint64 bytecode_hash;    // FNV-1a over the bytecode that follows
+} ScriptCacheHeader;
+
+typedef struct {
+    char *data;
+    size_t size;
+    size_t capacity;
+} DumpBuffer;
+
+static Uint64 fnv1a_hash(const void *data, size_t size) {
+    const unsigned char *bytes = data;
+    Uint64 hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static int dump_writer(lua_State *L, const void *p, size_t size, void *ud) {
+    (void)L;
+    DumpBuffer *buffer = ud;
+    if (buffer->size + size > buffer->capacity) {
+        size_t capacity = buffer->capacity ? buffer->capacity : 64 * 1024;
+        while (capacity < buffer->size + size) capacity *= 2;
+        char *data = realloc(buffer->data, capacity);
+        if (!data) return 1;
+        buffer->data = data;
+        buffer->capacity = capacity;
+    }
+    memcpy(buffer->data + buffer->size, p, size);
+    buffer->size += size;
+    return 0;
+}
+
+// Usable header for this Lua build with an intact payload, or NULL
+static const ScriptCacheHeader* cache_header(const void *cache, size_t cache_size) {
+    const ScriptCacheHeader *header = cache;
+    if (!cache || cache_size < sizeof(ScriptCacheHeader) ||
+        memcmp(header->magic, SCRIPT_CACHE_MAGIC, sizeof(header->magic)) != 0 ||
+        header->lua_version != LUA_VERSION_NUM ||
+        header->bytecode_size != cache_size - sizeof(ScriptCacheHeader) ||
+        header->bytecode_hash != fnv1a_hash(header + 1, header->bytecode_size)) {
+        return NULL;
+    }
+    return header;
+}
+
+// Dump the compiled chunk on top of the stack to the cache; failures only cost the next start
+static void write_script_cache(lua_State *L, const char *cache_path, Uint64 source_size, SDL_Time source_mtime, Uint64 source_hash) {
+    DumpBuffer buffer = { NULL, 0, 0 };
+    ScriptCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    dump_writer(L, &header, sizeof(header), &buffer); // placeholder, filled in below
+    if (!buffer.data || lua_dump(L, dump_writer, &buffer, 0) != 0) {
+        LOG_WARN(LOG_CATEGORY_LUA, "Failed to dump bytecode for '%s'", cache_path);
+        free(buffer.data);
+        return;
+    }
+    memcpy(header.magic, SCRIPT_CACHE_MAGIC, sizeof(header.magic));
+    header.lua_version = LUA_VERSION_NUM;
+    header.bytecode_size = (Uint32)(buffer.size - sizeof(header));
+    header.source_size = source_size;
+    header.source_mtime = source_mtime;
+    header.source_hash = source_hash;
+    header.bytecode_hash = fnv1a_hash(buffer.data + sizeof(header), header.bytecode_size);
+    memcpy(buffer.data, &header, sizeof(header));
+
+    // Write beside the cache and rename over it so a crash never leaves half a file
+    char temp_path[1024];
+    SDL_snprintf(temp_path, sizeof(temp_path), "%s.tmp", cache_path);
+    if (!SDL_SaveFile(temp_path, buffer.data, buffer.size) || !SDL_RenamePath(temp_path, cache_path)) {
+        LOG_WARN(LOG_CATEGORY_LUA, "Failed to write bytecode cache '%s': %s", cache_path, SDL_GetError());
+    }
+    free(buffer.data);
+}
+
+// Load the cached chunk; a chunk Lua rejects is treated like a stale cache
+static bool load_cached_chunk(lua_State *L, const ScriptCacheHeader *header, const char *chunk_name) {
+    const char *bytecode = (const char*)(header + 1);
+    if (luaL_loadbufferx(L, bytecode, header->bytecode_size, chunk_name, "b") == LUA_OK) {
+        return true;
+    }
+    LOG_WARN(LOG_CATEGORY_LUA, "Ignoring bytecode cache: %s", lua_tostring(L, -1));
+    lua_pop(L, 1);
+    return false;
+}
+
+// Like luaL_loadfile, going through the bytecode cache; leaves the chunk or an error message
+static int load_script(lua_State *L, const char *script_path) {
+    Uint64 start_ns = SDL_GetTicksNS();
+    char chunk_name[1024], cache_path[1024];
+    SDL_snprintf(chunk_name, sizeof(chunk_name), "@%s", script_path);
+    SDL_snprintf(cache_path, sizeof(cache_path), "%s.cache", script_path);
+    SDL_PathInfo info;
+    if (!SDL_GetPathInfo(script_path, &info)) {
+        return luaL_loadfilex(L, script_path, NULL); // reports the missing file the usual way
+    }
+
+    size_t cache_size = 0;
+    void *cache = SDL_LoadFile(cache_path, &cache_size);
+    const ScriptCacheHeader *header = cache_header(cache, cache_size);
+    if (header && header->source_size == info.size && header->source_mtime == info.modify_time &&
+        load_cached_chunk(L, header, chunk_name)) {
+        LOG_INFO(LOG_CATEGORY_LUA, "Loaded '%s' from bytecode cache in %.2f ms", script_path, (SDL_GetTicksNS() - start_ns) / 1e6);
+        SDL_free(cache);
+        return LUA_OK;
+    }
+
+    size_t source_size = 0;
+    char *source = SDL_LoadFile(script_path, &source_size);
+    if (!source) {
+        SDL_free(cache);
+        lua_pushfstring(L, "cannot read %s: %s", script_path, SDL_GetError());
+        return LUA_ERRFILE;
+    }
+    Uint64 source_hash = fnv1a_hash(source, source_size);
+    int status;
+    if (header && header->source_size == source_size && header->source_hash == source_hash &&
+        load_cached_chunk(L, header, chunk_name)) {
+        // Touched but unchanged: keep the bytecode, record the new mtime
+        LOG_DEBUG(LOG_CATEGORY_LUA, "Bytecode cache for '%s' matches by content", script_path);
+        status = LUA_OK;
+    } else {
+        status = luaL_loadbufferx(L, source, source_size, chunk_name, NULL);
+    }
+    if (status == LUA_OK) {
+        write_script_cache(L, cache_path, source_size, info.modify_time, source_hash);
+        LOG_INFO(LOG_CATEGORY_LUA, "Compiled '%s' (%zu bytes) in %.2f ms", script_path, source_size, (SDL_GetTicksNS() - start_ns) / 1e6);
+    }
+    SDL_free(source);
+    SDL_free(cache);
+    return status;
+}
+
 lua_State* lua_utils_init(const char *script_path) {
-    lua_State *L = luaL_newstate();
+    // Small objects (strings, tables, closures) come from size-class pools owned by this state
+    AllocPool *pool = alloc_pool_create();
+    if (!pool) {
+        LOG_ERROR(LOG_CATEGORY_LUA, "Failed to create Lua allocator");
+        return NULL;
+    }
+    lua_State *L = lua_newstate(alloc_pool_lua_alloc, pool);
     if (!L) {
-        printf("Failed to create Lua state\n");
+        LOG_ERROR(LOG_CATEGORY_LUA, "Failed to create Lua state");
+        alloc_pool_destroy(pool);
         return NULL;
     }
+    lua_atpanic(L, l_panic);
     luaL_openlibs(L);
-    if (luaL_dofile(L, script_path) != LUA_OK) {
-        printf("Failed to load Lua script '%s': %s\n", script_path, lua_tostring(L, -1));
+    LuaUtilsContext *context = create_context(L);
+    if (!context) {
+        LOG_ERROR(LOG_CATEGORY_LUA, "Failed to create Lua utils context");
         lua_close(L);
+        alloc_pool_destroy(pool);
         return NULL;
     }
+    context->pool = pool;
+    lua_utils_path_compile(L, &context->animate_path, "config.animate");
+    lua_register(L, "request_redraw", l_request_redraw);
+    lua_register(L, "memory_stats", l_memory_stats);
+    lua_register(L, "add_connection", l_add_connection);
+    lua_register(L, "remove_connection", l_remove_connection);
+    if (load_script(L, script_path) != LUA_OK || lua_pcall(L, 0, LUA_MULTRET, 0) != LUA_OK) {
+        LOG_ERROR(LOG_CATEGORY_LUA, "Failed to load Lua script '%s': %s", script_path, lua_tostring(L, -1));
+        lua_utils_cleanup(L);
+        return NULL;
+    }
+    lua_utils_configure_gc(L);
     return L;
 }
 
 void lua_utils_cleanup(lua_State *L) {
     if (L) {
+        LuaUtilsContext *context = get_context(L);
         lua_close(L);
+        alloc_pool_destroy(context->pool);
+        store_free(&context->connections);
+        free(context);
+    }
+}
+
+// Like lua_getfield, but "a.b" descends into nested tables; pushes nil when a step is missing
+static int get_dotted_field(lua_State *L, int table, const char *key) {
+    const char *dot = strchr(key, '.');
+    if (!dot) {
+        return lua_getfield(L, table, key);
+    }
+    lua_pushvalue(L, table);
+    for (; dot; key = dot + 1, dot = strchr(key, '.')) {
+        if (!lua_istable(L, -1)) {
+            lua_pop(L, 1);
+            lua_pushnil(L);
+            return LUA_TNIL;
+        }
+        lua_pushlstring(L, key, dot - key);
+        lua_gettable(L, -2);
+        lua_remove(L, -2);
     }
+    if (!lua_istable(L, -1)) {
+        lua_pop(L, 1);
+        lua_pushnil(L);
+        return LUA_TNIL;
+    }
+    int type = lua_getfield(L, -1, key);
+    lua_remove(L, -2);
+    return type;
+}
+
+// Like lua_setfield for the value on top, creating the tables along a dotted key
+static void set_dotted_field(lua_State *L, int table, const char *key) {
+    table = lua_absindex(L, table);
+    const char *dot = strchr(key, '.');
+    if (!dot) {
+        lua_setfield(L, table, key);
+        return;
+    }
+    lua_pushvalue(L, table);
+    for (; dot; key = dot + 1, dot = strchr(key, '.')) {
+        lua_pushlstring(L, key, dot - key);
+        lua_gettable(L, -2);
+        if (!lua_istable(L, -1)) {
+            lua_pop(L, 1);
+            lua_newtable(L);
+            lua_pushlstring(L, key, dot - key);
+            lua_pushvalue(L, -2);
+            lua_settable(L, -4);
+        }
+        lua_remove(L, -2);
+    }
+    lua_insert(L, -2); // value above its table
+    lua_setfield(L, -2, key);
+    lua_pop(L, 1);
 }
 
 const char* lua_utils_get_string(lua_State *L, const char *table, const char *key, const char *default_value) {
-    lua_getglobal(L, table);
+    push_global_table(L, table);
     if (!lua_istable(L, -1)) {
         lua_pop(L, 1);
         return default_value;
     }
-    lua_getfield(L, -1, key);
+    get_dotted_field(L, -1, key);
     const char *value = lua_isstring(L, -1) ? lua_tostring(L, -1) : default_value;
     lua_pop(L, 2);
     return value;
 }
 
 int lua_utils_get_integer(lua_State *L, const char *table, const char *key, int default_value) {
-    lua_getglobal(L, table);
+    push_global_table(L, table);
     if (!lua_istable(L, -1)) {
         lua_pop(L, 1);
         return default_value;
     }
-    lua_getfield(L, -1, key);
+    get_dotted_field(L, -1, key);
     int value = lua_isnumber(L, -1) ? (int)lua_tointeger(L, -1) : default_value;
     lua_pop(L, 2);
     return value;
 }
 
+bool lua_utils_get_boolean(lua_State *L, const char *table, const char *key, bool default_value) {
+    push_global_table(L, table);
+    if (!lua_istable(L, -1)) {
+        lua_pop(L, 1);
+        return default_value;
+    }
+    get_dotted_field(L, -1, key);
+    bool value = lua_isboolean(L, -1) ? lua_toboolean(L, -1) : default_value;
+    lua_pop(L, 2);
+    return value;
+}
+
 float lua_utils_get_number(lua_State *L, const char *table, const char *key, float default_value) {
-    lua_getglobal(L, table);
+    push_global_table(L, table);
     if (!lua_istable(L, -1)) {
         lua_pop(L, 1);
         return default_value;
     }
-    lua_getfield(L, -1, key);
+    get_dotted_field(L, -1, key);
     float value = lua_isnumber(L, -1) ? (float)lua_tonumber(L, -1) : default_value;
     lua_pop(L, 2);
     return value;
 }
 
 void lua_utils_set_number(lua_State *L, const char *table, const char *key, float value) {
-    lua_getglobal(L, table);
+    push_global_table(L, table);
     if (!lua_istable(L, -1)) {
         lua_pop(L, 1);
         lua_newtable(L);
-        lua_setglobal(L, table);
-        lua_getglobal(L, table);
+        set_global_table(L, table);
+        push_global_table(L, table);
     }
     lua_pushnumber(L, value);
-    lua_setfield(L, -2, key);
+    set_dotted_field(L, -2, key);
     lua_pop(L, 1);
 }
 
+void lua_utils_request_redraw(lua_State *L) {
+    get_context(L)->redraw_requested = true;
+}
+
+bool lua_utils_nodes_replaced(lua_State *L) {
+    LuaUtilsContext *context = get_context(L);
+    bool replaced = context->nodes_replaced;
+    context->nodes_replaced = false;
+    return replaced;
+}
+
+void lua_utils_memory_stats(lua_State *L, AllocStats *stats) {
+    alloc_pool_get_stats(get_context(L)->pool, stats);
+}
+
+void lua_utils_end_frame(lua_State *L) {
+    alloc_pool_end_frame(get_context(L)->pool);
+}
+
+void lua_utils_configure_gc(lua_State *L) {
+    LuaUtilsContext *context = get_context(L);
+    const char *mode = lua_utils_get_string(L, "config", "gc.mode", "incremental");
+    float budget_ms = lua_utils_get_number(L, "config", "gc.budget_ms", 1.0f);
+    if (strcmp(mode, "generational") == 0) {
+        // Minor collections are short and cannot be split, so they stay automatic
+        lua_gc(L, LUA_GCGEN,
+               lua_utils_get_integer(L, "config", "gc.minor_multiplier", 20),
+               lua_utils_get_integer(L, "config", "gc.major_multiplier", 100));
+        context->gc_budget_ns = 0;
+    } else {
+        context->gc_pause = lua_utils_get_integer(L, "config", "gc.pause", 200);
+        lua_gc(L, LUA_GCINC, context->gc_pause,
+               lua_utils_get_integer(L, "config", "gc.stepmul", 100),
+               lua_utils_get_integer(L, "config", "gc.stepsize", 13));
+        context->gc_budget_ns = budget_ms > 0.0f ? (Uint64)(budget_ms * 1e6) : 0;
+    }
+    if (context->gc_budget_ns > 0) {
+        // All collection work moves into lua_utils_gc_step
+        lua_gc(L, LUA_GCSTOP);
+        context->gc_baseline_kb = lua_gc(L, LUA_GCCOUNT);
+        context->gc_in_cycle = false;
+    } else {
+        lua_gc(L, LUA_GCRESTART);
+    }
+    LOG_INFO(LOG_CATEGORY_LUA, "Lua GC: %s, frame budget %.2f ms", mode, context->gc_budget_ns / 1e6);
+}
+
+int lua_utils_gc_step(lua_State *L, Uint64 available_ns) {
+    LuaUtilsContext *context = get_context(L);
+    if (context->gc_budget_ns == 0) {
+        return 0;
+    }
+    // Like the automatic pause: no new cycle until the heap grew past the threshold. A cycle
+    // that started keeps stepping even after its sweep brought the heap back under it.
+    int heap_kb = lua_gc(L, LUA_GCCOUNT);
+    int threshold_kb = (int)((long long)context->gc_baseline_kb * context->gc_pause / 100);
+    if (!context->gc_in_cycle) {
+        if (heap_kb < threshold_kb) {
+            return 0;
+        }
+        context->gc_in_cycle = true;
+    }
+    Uint64 budget = available_ns < context->gc_budget_ns ? available_ns : context->gc_budget_ns;
+    Uint64 deadline = SDL_GetTicksNS() + budget;
+    // Far behind: take a step even without time left so memory stays bounded
+    bool forced = heap_kb > threshold_kb * 2;
+    int steps = 0;
+    while (forced || SDL_GetTicksNS() < deadline) {
+        forced = false;
+        steps++;
+        if (lua_gc(L, LUA_GCSTEP, 0)) {
+            context->gc_baseline_kb = lua_gc(L, LUA_GCCOUNT);
+            context->gc_in_cycle = false;
+            break;
+        }
+    }
+    return steps;
+}
+
+void lua_utils_gc_automatic(lua_State *L) {
+    LuaUtilsContext *context = get_context(L);
+    context->gc_budget_ns = 0;
+    context->gc_in_cycle = false;
+    lua_gc(L, LUA_GCRESTART);
+}
+
+bool lua_utils_redraw_requested(lua_State *L) {
+    LuaUtilsContext *context = get_context(L);
+    bool requested = context->redraw_requested;
+    context->redraw_requested = false;
+    return requested || lua_utils_path_get_boolean(L, &context->animate_path, false);
+}
+
+void lua_utils_run_frame(lua_State *L, double dt) {
+    if (push_tracked(L, TRACKED_ON_FRAME) != LUA_TFUNCTION) {
+        lua_pop(L, 1);
+        return;
+    }
+    lua_pushnumber(L, dt);
+    if (lua_pcall(L, 1, 0, 0) != LUA_OK) {
+        LOG_WARN(LOG_CATEGORY_LUA, "on_frame failed: %s", lua_tostring(L, -1));
+        lua_pop(L, 1);
+    }
+}
+
+// Node collections and nodes may be plain tables or userdata proxies with metamethods
+static bool is_indexable(lua_State *L, int index) {
+    int type = lua_type(L, index);
+    return type == LUA_TTABLE || type == LUA_TUSERDATA;
+}
+
+// Push nodes[node_index] honoring __index; returns false (nothing pushed) when missing
+static bool push_node(lua_State *L, int node_index) {
+    push_tracked(L, TRACKED_NODES);
+    if (!is_indexable(L, -1)) {
+        lua_pop(L, 1);
+        return false;
+    }
+    lua_geti(L, -1, node_index);
+    lua_remove(L, -2);
+    if (!is_indexable(L, -1)) {
+        lua_pop(L, 1);
+        return false;
+    }
+    return true;
+}
+
+int lua_utils_node_field(lua_State *L, int index) {
+    if (lua_type(L, index) != LUA_TSTRING) return -1;
+    const char *key = lua_tostring(L, index);
+    const char **keys = get_context(L)->keys;
+    for (int field = 0; field < LUA_NODE_FIELD_COUNT; field++) {
+        if (key == keys[field]) return field;
+    }
+    return -1;
+}
+
 int lua_utils_get_nodes_count(lua_State *L) {
-    lua_getglobal(L, "nodes");
-    if (!lua_istable(L, -1)) {
+    push_tracked(L, TRACKED_NODES);
+    if (!is_indexable(L, -1)) {
         lua_pop(L, 1);
         return 0;
     }
-    int count = lua_rawlen(L, -1);
-    lua_pop(L, 1);
+    lua_len(L, -1);
+    int count = (int)lua_tointeger(L, -1);
+    lua_pop(L, 2);
     return count;
 }
 
 float lua_utils_get_node_number(lua_State *L, int node_index, const char *key, float default_value) {
-    lua_getglobal(L, "nodes");
-    if (!lua_istable(L, -1)) {
-        lua_pop(L, 1);
-        return default_value;
-    }
-    lua_rawgeti(L, -1, node_index);
-    if (!lua_istable(L, -1)) {
-        lua_pop(L, 2);
+    if (!push_node(L, node_index)) {
         return default_value;
     }
     lua_getfield(L, -1, key);
     float value = lua_isnumber(L, -1) ? (float)lua_tonumber(L, -1) : default_value;
-    lua_pop(L, 3);
+    lua_pop(L, 2);
     return value;
 }
 
 void lua_utils_set_node_number(lua_State *L, int node_index, const char *key, float value) {
-    lua_getglobal(L, "nodes");
-    if (!lua_istable(L, -1)) {
+    push_tracked(L, TRACKED_NODES);
+    if (!is_indexable(L, -1)) {
         lua_pop(L, 1);
         lua_newtable(L);
-        lua_setglobal(L, "nodes");
-        lua_getglobal(L, "nodes");
+        lua_pushvalue(L, -1);
+        set_tracked(L, TRACKED_NODES);
     }
-    lua_rawgeti(L, -1, node_index);
-    if (!lua_istable(L, -1)) {
+    lua_geti(L, -1, node_index);
+    if (!is_indexable(L, -1)) {
         lua_pop(L, 1);
         lua_newtable(L);
-        lua_rawseti(L, -2, node_index);
-        lua_rawgeti(L, -1, node_index);
+        lua_pushvalue(L, -1);
+        lua_seti(L, -3, node_index);
     }
     lua_pushnumber(L, value);
     lua_setfield(L, -2, key);
@@ -125,145 +1040,554 @@ void lua_utils_set_node_number(lua_State *L, int node_index, const char *key, fl
 }
 
 const char* lua_utils_get_node_text(lua_State *L, int node_index, const char *default_value) {
-    lua_getglobal(L, "nodes");
-    if (!lua_istable(L, -1)) {
-        lua_pop(L, 1);
+    if (!push_node(L, node_index)) {
         return default_value;
     }
-    lua_rawgeti(L, -1, node_index);
-    if (!lua_istable(L, -1)) {
+    bool proxy = !lua_istable(L, -1);
+    push_key(L, KEY_TEXT);
+    lua_gettable(L, -2);
+    if (!lua_isstring(L, -1)) {
         lua_pop(L, 2);
         return default_value;
     }
-    lua_getfield(L, -1, "text");
-    const char *value = lua_isstring(L, -1) ? lua_tostring(L, -1) : default_value;
-    lua_pop(L, 3);
+    if (proxy) {
+        // A proxy builds the string on demand; anchor it until the next call
+        lua_pushvalue(L, -1);
+        lua_setfield(L, LUA_REGISTRYINDEX, TEXT_ANCHOR_KEY);
+    }
+    const char *value = lua_tostring(L, -1);
+    lua_pop(L, 2);
     return value;
 }
 
 int lua_utils_get_node_connectors(lua_State *L, int node_index, const char *key, int default_value) {
-    lua_getglobal(L, "nodes");
-    if (!lua_istable(L, -1)) {
-        lua_pop(L, 1);
-        return default_value;
-    }
-    lua_rawgeti(L, -1, node_index);
-    if (!lua_istable(L, -1)) {
-        lua_pop(L, 2);
+    if (!push_node(L, node_index)) {
         return default_value;
     }
     lua_getfield(L, -1, key);
     int value = lua_isnumber(L, -1) ? (int)lua_tointeger(L, -1) : default_value;
-    lua_pop(L, 3);
+    lua_pop(L, 2);
     return value;
 }
 
 int lua_utils_get_connections_count(lua_State *L) {
-    lua_getglobal(L, "connections");
+    return get_connection_store(L)->count;
+}
+
+void lua_utils_get_connection(lua_State *L, int conn_index, int *from_node, int *from_output, int *to_node, int *to_input) {
+    ConnectionStore *store = get_connection_store(L);
+    if (conn_index < 1 || conn_index > store->count) {
+        *from_node = *from_output = *to_node = *to_input = 0;
+        return;
+    }
+    const LuaConnection *connection = &store->edges[conn_index - 1];
+    *from_node = connection->from_node;
+    *from_output = connection->from_output;
+    *to_node = connection->to_node;
+    *to_input = connection->to_input;
+}
+
+const LuaConnection* lua_utils_get_connections(lua_State *L, int *count) {
+    ConnectionStore *store = get_connection_store(L);
+    *count = store->count;
+    return store->edges;
+}
+
+const int* lua_utils_get_node_edges(lua_State *L, int node_id, bool incoming, int *count) {
+    ConnectionStore *store = get_connection_store(L);
+    int lists = node_lists(store, node_id);
+    if (lists < 0) {
+        *count = 0;
+        return NULL;
+    }
+    EdgeList *list = incoming ? &store->incoming[lists] : &store->outgoing[lists];
+    *count = list->count;
+    return list->edges;
+}
+
+void lua_utils_add_connection(lua_State *L, int from_node, int from_output, int to_node, int to_input) {
+    LuaConnection connection = { from_node, from_output, to_node, to_input };
+    if (store_add(get_connection_store(L), &connection) < 0) {
+        LOG_ERROR(LOG_CATEGORY_LUA, "Failed to add connection %d:%d -> %d:%d", from_node, from_output, to_node, to_input);
+        return;
+    }
+    notify_connection(L, &connection, true);
+}
+
+void lua_utils_remove_connections(lua_State *L, int node_id, const char *type, int connector_index) {
+    ConnectionStore *store = get_connection_store(L);
+    int lists = node_lists(store, node_id);
+    if (lists < 0) {
+        return;
+    }
+    // Only the connector's own node list is scanned; removal swaps the last entry into
+    // the freed slot, so walking backwards visits every remaining entry once
+    bool input = strcmp(type, "input") == 0;
+    EdgeList *list = input ? &store->incoming[lists] : &store->outgoing[lists];
+    for (int k = list->count - 1; k >= 0; k--) {
+        int edge = list->edges[k];
+        const LuaConnection *connection = &store->edges[edge];
+        int connector = input ? connection->to_input : connection->from_output;
+        if (connector == connector_index) {
+            remove_connection_at(L, store, edge);
+        }
+    }
+}
+
+// Index of an edge equal to connection, found through the source node's list; -1 when absent
+static int find_edge(ConnectionStore *store, const LuaConnection *connection) {
+    int lists = node_lists(store, connection->from_node);
+    if (lists < 0) {
+        return -1;
+    }
+    const EdgeList *list = &store->outgoing[lists];
+    for (int k = 0; k < list->count; k++) {
+        const LuaConnection *edge = &store->edges[list->edges[k]];
+        if (edge->from_output == connection->from_output && edge->to_node == connection->to_node &&
+            edge->to_input == connection->to_input) {
+            return list->edges[k];
+        }
+    }
+    return -1;
+}
+
+bool lua_utils_has_connection(lua_State *L, const LuaConnection *connection) {
+    return find_edge(get_connection_store(L), connection) >= 0;
+}
+
+bool lua_utils_remove_connection(lua_State *L, const LuaConnection *connection) {
+    ConnectionStore *store = get_connection_store(L);
+    int edge = find_edge(store, connection);
+    if (edge < 0) {
+        return false;
+    }
+    remove_connection_at(L, store, edge);
+    return true;
+}
+
+void lua_utils_remove_node_connections(lua_State *L, int node_id) {
+    ConnectionStore *store = get_connection_store(L);
+    int node = node_lists(store, node_id);
+    if (node < 0) {
+        return;
+    }
+    EdgeList *lists[2] = { &store->incoming[node], &store->outgoing[node] };
+    for (int l = 0; l < 2; l++) {
+        while (lists[l]->count > 0) {
+            remove_connection_at(L, store, lists[l]->edges[lists[l]->count - 1]);
+        }
+    }
+}
+
+void lua_utils_set_connection_listener(lua_State *L, LuaConnectionListener listener, void *user) {
+    LuaUtilsContext *context = get_context(L);
+    context->connection_listener = listener;
+    context->connection_listener_user = user;
+}
+
+// Fill a node from one lua_next walk over its fields instead of a hashed lookup per field;
+// keys are matched by address against the interned names
+static void read_node_fields(lua_State *L, int table, LuaNode *node) {
+    const char **keys = get_context(L)->keys;
+    *node = (LuaNode){ 400.0f, 300.0f, 100.0f, 1.0f, 0.0f, 0.0f, 0, 0, "", 0, "", 0.0f };
+    lua_pushnil(L);
+    while (lua_next(L, table)) {
+        if (lua_type(L, -2) == LUA_TSTRING) {
+            const char *key = lua_tostring(L, -2);
+            if (lua_type(L, -1) == LUA_TNUMBER) {
+                float value = (float)lua_tonumber(L, -1);
+                if (key == keys[KEY_X]) node->x = value;
+                else if (key == keys[KEY_Y]) node->y = value;
+                else if (key == keys[KEY_SIZE]) node->size = value;
+                else if (key == keys[KEY_R]) node->r = value;
+                else if (key == keys[KEY_G]) node->g = value;
+                else if (key == keys[KEY_B]) node->b = value;
+                else if (key == keys[KEY_INPUTS]) node->inputs = (int)lua_tointeger(L, -1);
+                else if (key == keys[KEY_OUTPUTS]) node->outputs = (int)lua_tointeger(L, -1);
+                else if (key == keys[KEY_ID]) node->id = (int)lua_tointeger(L, -1);
+                else if (key == keys[KEY_VALUE]) node->value = value;
+            } else if (lua_type(L, -1) == LUA_TSTRING) {
+                // the table keeps the strings alive
+                if (key == keys[KEY_TEXT]) node->text = lua_tostring(L, -1);
+                else if (key == keys[KEY_KERNEL]) node->kernel = lua_tostring(L, -1);
+            }
+        }
+        lua_pop(L, 1);
+    }
+}
+
+typedef struct {
+    int id;
+    int index;
+    bool implicit;   // the node had no id and asked for its position
+} IdClaim;
+
+static int compare_claims(const void *a, const void *b) {
+    const IdClaim *left = a, *right = b;
+    if (left->id != right->id) return left->id < right->id ? -1 : 1;
+    if (left->implicit != right->implicit) return left->implicit ? 1 : -1;
+    return left->index < right->index ? -1 : left->index > right->index;
+}
+
+// Make the ids distinct and in range, the same way for the same script, so the store never
+// renumbers on load and reload snapshots match the live nodes one to one. Explicit ids win
+// over the positions of nodes without one, earlier entries win ties, and the rest get fresh
+// ids past the highest one in use. A negative id marks a node without one asking for -id.
+static void assign_unique_ids(LuaNode *nodes, int count) {
+    IdClaim *claims = malloc((count > 0 ? count : 1) * sizeof(IdClaim));
+    if (!claims) {
+        LOG_ERROR(LOG_CATEGORY_LUA, "Failed to allocate id check for %d nodes", count);
+        for (int i = 0; i < count; i++) {
+            if (nodes[i].id < 0) nodes[i].id = -nodes[i].id; // unchecked; the store renumbers clashes
+        }
+        return;
+    }
+    for (int i = 0; i < count; i++) {
+        bool implicit = nodes[i].id < 0;
+        claims[i] = (IdClaim){ implicit ? -nodes[i].id : nodes[i].id, i, implicit };
+    }
+    qsort(claims, count, sizeof(IdClaim), compare_claims);
+    int highest = 0;
+    for (int k = 0; k < count; k++) {
+        int id = claims[k].id;
+        if (id < 1 || id > LUA_NODE_ID_MAX || (k > 0 && claims[k - 1].id == id)) {
+            if (!claims[k].implicit) {
+                LOG_WARN(LOG_CATEGORY_LUA, "Node %d: id %d is taken or out of range; giving it a new one",
+                         claims[k].index + 1, id);
+            }
+            nodes[claims[k].index].id = 0;
+        } else if (id > highest) {
+            highest = id;
+        }
+    }
+    for (int i = 0; i < count; i++) {
+        if (nodes[i].id == 0 && highest < LUA_NODE_ID_MAX) {
+            nodes[i].id = ++highest;
+        }
+    }
+    free(claims);
+}
+
+int lua_utils_read_nodes(lua_State *L, LuaNode *nodes, int max_count) {
+    push_tracked(L, TRACKED_NODES);
     if (!lua_istable(L, -1)) {
         lua_pop(L, 1);
         return 0;
     }
-    int count = lua_rawlen(L, -1);
+    int count = (int)lua_rawlen(L, -1);
+    int read_count = count < max_count ? count : max_count;
+    for (int i = 0; i < read_count; i++) {
+        lua_rawgeti(L, -1, i + 1);
+        if (lua_istable(L, -1)) {
+            read_node_fields(L, lua_gettop(L), &nodes[i]);
+        } else {
+            nodes[i] = (LuaNode){ 400.0f, 300.0f, 100.0f, 1.0f, 0.0f, 0.0f, 0, 0, "", 0, "", 0.0f };
+        }
+        if (nodes[i].id <= 0) {
+            nodes[i].id = -(i + 1); // no id: ask for its position
+        }
+        lua_pop(L, 1);
+    }
     lua_pop(L, 1);
+    assign_unique_ids(nodes, read_count);
     return count;
 }
 
-void lua_utils_get_connection(lua_State *L, int conn_index, int *from_node, int *from_output, int *to_node, int *to_input) {
-    lua_getglobal(L, "connections");
-    if (!lua_istable(L, -1)) {
+int lua_utils_read_connections(lua_State *L, LuaConnection *connections, int max_count) {
+    ConnectionStore *store = get_connection_store(L);
+    int read_count = store->count < max_count ? store->count : max_count;
+    if (read_count > 0) {
+        memcpy(connections, store->edges, read_count * sizeof(LuaConnection));
+    }
+    return store->count;
+}
+
+void lua_utils_write_nodes(lua_State *L, const LuaNode *nodes, int count) {
+    push_tracked(L, TRACKED_NODES);
+    if (!is_indexable(L, -1)) {
         lua_pop(L, 1);
-        *from_node = *from_output = *to_node = *to_input = 0;
-        return;
+        lua_createtable(L, count, 0);
+        lua_pushvalue(L, -1);
+        set_tracked(L, TRACKED_NODES);
     }
-    lua_rawgeti(L, -1, conn_index);
-    if (!lua_istable(L, -1)) {
-        lua_pop(L, 2);
-        *from_node = *from_output = *to_node = *to_input = 0;
-        return;
+    bool proxy = !lua_istable(L, -1);
+    for (int i = 0; i < count; i++) {
+        lua_geti(L, -1, i + 1);
+        if (!is_indexable(L, -1)) {
+            lua_pop(L, 1);
+            if (proxy) continue; // a proxy collection only has the nodes its store holds
+            lua_createtable(L, 0, 12);
+            lua_pushvalue(L, -1);
+            lua_rawseti(L, -3, i + 1);
+        }
+        const LuaNode *node = &nodes[i];
+        set_key_number(L, -1, KEY_X, node->x);
+        set_key_number(L, -1, KEY_Y, node->y);
+        set_key_number(L, -1, KEY_SIZE, node->size);
+        set_key_number(L, -1, KEY_R, node->r);
+        set_key_number(L, -1, KEY_G, node->g);
+        set_key_number(L, -1, KEY_B, node->b);
+        set_key_integer(L, -1, KEY_INPUTS, node->inputs);
+        set_key_integer(L, -1, KEY_OUTPUTS, node->outputs);
+        if (node->text) {
+            push_key(L, KEY_TEXT);
+            lua_pushstring(L, node->text);
+            lua_settable(L, -3);
+        }
+        set_key_number(L, -1, KEY_VALUE, node->value);
+        if (node->kernel && node->kernel[0] != '\0') {
+            push_key(L, KEY_KERNEL);
+            lua_pushstring(L, node->kernel);
+            lua_settable(L, -3);
+        }
+        if (!proxy && node->id > 0) {
+            set_key_integer(L, -1, KEY_ID, node->id); // proxies report the store's id
+        }
+        lua_pop(L, 1);
     }
-    lua_getfield(L, -1, "from_node");
-    *from_node = lua_isnumber(L, -1) ? (int)lua_tointeger(L, -1) : 0;
-    lua_pop(L, 1);
-    lua_getfield(L, -1, "from_output");
-    *from_output = lua_isnumber(L, -1) ? (int)lua_tointeger(L, -1) : 0;
-    lua_pop(L, 1);
-    lua_getfield(L, -1, "to_node");
-    *to_node = lua_isnumber(L, -1) ? (int)lua_tointeger(L, -1) : 0;
     lua_pop(L, 1);
-    lua_getfield(L, -1, "to_input");
-    *to_input = lua_isnumber(L, -1) ? (int)lua_tointeger(L, -1) : 0;
-    lua_pop(L, 2);
 }
 
-void lua_utils_add_connection(lua_State *L, int from_node, int from_output, int to_node, int to_input) {
-    lua_getglobal(L, "connections");
-    if (!lua_istable(L, -1)) {
+void lua_utils_write_connections(lua_State *L, const LuaConnection *connections, int count) {
+    ConnectionStore *store = get_connection_store(L);
+    store_clear(store);
+    for (int i = 0; i < count; i++) {
+        if (store_add(store, &connections[i]) < 0) {
+            LOG_ERROR(LOG_CATEGORY_LUA, "Failed to index connection %d of %d", i + 1, count);
+            break;
+        }
+    }
+    notify_connection(L, NULL, true);
+}
+
+// Config values cross states by copy; tables nest at most this deep
+#define MERGE_MAX_DEPTH 16
+
+// Push onto `to` a copy of the string or number key at from_index
+static void push_copied_key(lua_State *to, lua_State *from, int from_index) {
+    if (lua_type(from, from_index) == LUA_TSTRING) {
+        size_t length;
+        const char *key = lua_tolstring(from, from_index, &length);
+        lua_pushlstring(to, key, length);
+    } else if (lua_isinteger(from, from_index)) {
+        lua_pushinteger(to, lua_tointeger(from, from_index));
+    } else {
+        lua_pushnumber(to, lua_tonumber(from, from_index));
+    }
+}
+
+static bool values_equal(lua_State *to, int to_index, lua_State *from, int from_index) {
+    int type = lua_type(from, from_index);
+    if (lua_type(to, to_index) != type) {
+        return false;
+    }
+    switch (type) {
+    case LUA_TNIL:
+        return true;
+    case LUA_TBOOLEAN:
+        return lua_toboolean(to, to_index) == lua_toboolean(from, from_index);
+    case LUA_TNUMBER:
+        if (lua_isinteger(to, to_index) && lua_isinteger(from, from_index)) {
+            return lua_tointeger(to, to_index) == lua_tointeger(from, from_index);
+        }
+        return lua_tonumber(to, to_index) == lua_tonumber(from, from_index);
+    case LUA_TSTRING: {
+        size_t to_length, from_length;
+        const char *to_string = lua_tolstring(to, to_index, &to_length);
+        const char *from_string = lua_tolstring(from, from_index, &from_length);
+        return to_length == from_length && memcmp(to_string, from_string, to_length) == 0;
+    }
+    default:
+        return false;
+    }
+}
+
+static int merge_table(lua_State *to, int to_table, lua_State *from, int from_table, const char *skip_key, int depth);
+
+// Push onto `to` a copy of a plain value; false (nothing pushed) for functions, userdata and threads
+static bool push_copied_value(lua_State *to, lua_State *from, int from_index, int depth) {
+    switch (lua_type(from, from_index)) {
+    case LUA_TBOOLEAN:
+        lua_pushboolean(to, lua_toboolean(from, from_index));
+        return true;
+    case LUA_TNUMBER:
+    case LUA_TSTRING:
+        push_copied_key(to, from, from_index);
+        return true;
+    case LUA_TTABLE:
+        if (depth >= MERGE_MAX_DEPTH) return false;
+        lua_newtable(to);
+        merge_table(to, lua_gettop(to), from, lua_absindex(from, from_index), NULL, depth + 1);
+        return true;
+    default:
+        return false;
+    }
+}
+
+// Write every entry of from_table that differs into to_table, descending into tables
+// present on both sides; returns the number of values written
+static int merge_table(lua_State *to, int to_table, lua_State *from, int from_table, const char *skip_key, int depth) {
+    luaL_checkstack(to, 4, "config merge");
+    luaL_checkstack(from, 4, "config merge");
+    int written = 0;
+    lua_pushnil(from);
+    while (lua_next(from, from_table)) {
+        int key_type = lua_type(from, -2);
+        bool skipped = key_type != LUA_TSTRING && key_type != LUA_TNUMBER;
+        if (!skipped && skip_key && key_type == LUA_TSTRING) {
+            skipped = strcmp(lua_tostring(from, -2), skip_key) == 0;
+        }
+        if (!skipped) {
+            push_copied_key(to, from, -2);
+            lua_pushvalue(to, -1);
+            lua_rawget(to, to_table);
+            if (lua_istable(to, -1) && lua_istable(from, -1)) {
+                if (depth < MERGE_MAX_DEPTH) {
+                    written += merge_table(to, lua_gettop(to), from, lua_gettop(from), NULL, depth + 1);
+                }
+                lua_pop(to, 2);
+            } else if (values_equal(to, -1, from, -1)) {
+                lua_pop(to, 2);
+            } else {
+                lua_pop(to, 1);
+                if (push_copied_value(to, from, -1, depth)) {
+                    lua_rawset(to, to_table);
+                    written++;
+                } else {
+                    lua_pop(to, 1);
+                }
+            }
+        }
+        lua_pop(from, 1);
+    }
+    return written;
+}
+
+int lua_utils_merge_config(lua_State *L, lua_State *from, const char *skip_key) {
+    if (push_tracked(from, TRACKED_CONFIG) != LUA_TTABLE) {
+        lua_pop(from, 1);
+        return 0;
+    }
+    if (push_tracked(L, TRACKED_CONFIG) != LUA_TTABLE) {
         lua_pop(L, 1);
         lua_newtable(L);
-        lua_setglobal(L, "connections");
-        lua_getglobal(L, "connections");
-    }
-    int count = lua_rawlen(L, -1) + 1;
-    lua_newtable(L);
-    lua_pushinteger(L, from_node);
-    lua_setfield(L, -2, "from_node");
-    lua_pushinteger(L, from_output);
-    lua_setfield(L, -2, "from_output");
-    lua_pushinteger(L, to_node);
-    lua_setfield(L, -2, "to_node");
-    lua_pushinteger(L, to_input);
-    lua_setfield(L, -2, "to_input");
-    lua_rawseti(L, -2, count);
+        lua_pushvalue(L, -1);
+        set_tracked(L, TRACKED_CONFIG);
+    }
+    int written = merge_table(L, lua_gettop(L), from, lua_gettop(from), skip_key, 0);
     lua_pop(L, 1);
+    lua_pop(from, 1);
+    return written;
 }
 
-void lua_utils_remove_connections(lua_State *L, int node_index, const char *type, int connector_index) {
-    lua_getglobal(L, "connections");
-    if (!lua_istable(L, -1)) {
-        lua_pop(L, 1);
+bool lua_utils_path_compile(lua_State *L, LuaPath *path, const char *path_string) {
+    path->root_tracked = -1;
+    path->root_ref = LUA_NOREF;
+    path->depth = 0;
+    const char *dot = strchr(path_string, '.');
+    if (!dot || dot == path_string) {
+        return false;
+    }
+    lua_pushlstring(L, path_string, dot - path_string);
+    path->root_tracked = tracked_index(lua_tostring(L, -1));
+    path->root_ref = luaL_ref(L, LUA_REGISTRYINDEX);
+    for (const char *key = dot + 1; ; key = dot + 1) {
+        dot = strchr(key, '.');
+        size_t length = dot ? (size_t)(dot - key) : strlen(key);
+        if (length == 0 || path->depth == LUA_PATH_MAX_DEPTH) {
+            LOG_ERROR(LOG_CATEGORY_LUA, "Invalid Lua path '%s'", path_string);
+            lua_utils_path_release(L, path);
+            return false;
+        }
+        lua_pushlstring(L, key, length);
+        path->key_refs[path->depth++] = luaL_ref(L, LUA_REGISTRYINDEX);
+        if (!dot) break;
+    }
+    return true;
+}
+
+void lua_utils_path_release(lua_State *L, LuaPath *path) {
+    luaL_unref(L, LUA_REGISTRYINDEX, path->root_ref);
+    for (int i = 0; i < path->depth; i++) {
+        luaL_unref(L, LUA_REGISTRYINDEX, path->key_refs[i]);
+    }
+    path->root_tracked = -1;
+    path->root_ref = LUA_NOREF;
+    path->depth = 0;
+}
+
+static void push_path_root(lua_State *L, const LuaPath *path) {
+    if (path->root_tracked >= 0) {
+        push_tracked(L, path->root_tracked);
         return;
     }
-    int count = lua_rawlen(L, -1);
-    int new_count = 0;
-    lua_newtable(L); // New connections table
-    for (int i = 1; i <= count; i++) {
-        lua_rawgeti(L, -2, i);
-        if (lua_istable(L, -1)) {
-            lua_getfield(L, -1, "from_node");
-            int from_node = lua_tointeger(L, -1);
-            lua_pop(L, 1);
-            lua_getfield(L, -1, "from_output");
-            int from_output = lua_tointeger(L, -1);
+    lua_pushglobaltable(L);
+    lua_rawgeti(L, LUA_REGISTRYINDEX, path->root_ref);
+    lua_gettable(L, -2);
+    lua_remove(L, -2);
+}
+
+// Push the value at the end of the path, or nil when a step is missing
+static void push_path_value(lua_State *L, const LuaPath *path) {
+    push_path_root(L, path);
+    for (int i = 0; i < path->depth; i++) {
+        if (!lua_istable(L, -1)) {
             lua_pop(L, 1);
-            lua_getfield(L, -1, "to_node");
-            int to_node = lua_tointeger(L, -1);
+            lua_pushnil(L);
+            return;
+        }
+        lua_rawgeti(L, LUA_REGISTRYINDEX, path->key_refs[i]);
+        lua_rawget(L, -2);
+        lua_remove(L, -2);
+    }
+}
+
+float lua_utils_path_get_number(lua_State *L, const LuaPath *path, float default_value) {
+    push_path_value(L, path);
+    float value = lua_isnumber(L, -1) ? (float)lua_tonumber(L, -1) : default_value;
+    lua_pop(L, 1);
+    return value;
+}
+
+bool lua_utils_path_get_boolean(lua_State *L, const LuaPath *path, bool default_value) {
+    push_path_value(L, path);
+    bool value = lua_isboolean(L, -1) ? lua_toboolean(L, -1) : default_value;
+    lua_pop(L, 1);
+    return value;
+}
+
+void lua_utils_path_set_number(lua_State *L, const LuaPath *path, float value) {
+    if (path->depth == 0) return;
+    push_path_root(L, path);
+    if (!lua_istable(L, -1)) {
+        lua_pop(L, 1);
+        lua_newtable(L);
+        lua_pushvalue(L, -1);
+        if (path->root_tracked >= 0) {
+            set_tracked(L, path->root_tracked);
+        } else {
+            lua_pushglobaltable(L);
+            lua_rawgeti(L, LUA_REGISTRYINDEX, path->root_ref);
+            lua_rotate(L, -3, -1); // globals, name, table
+            lua_settable(L, -3);
             lua_pop(L, 1);
-            lua_getfield(L, -1, "to_input");
-            int to_input = lua_tointeger(L, -1);
+        }
+    }
+    // Descend to the parent of the last key, creating tables as needed
+    for (int i = 0; i < path->depth - 1; i++) {
+        lua_rawgeti(L, LUA_REGISTRYINDEX, path->key_refs[i]);
+        lua_rawget(L, -2);
+        if (!lua_istable(L, -1)) {
             lua_pop(L, 1);
-            bool keep = true;
-            if (strcmp(type, "input") == 0 && to_node == node_index && to_input == connector_index) {
-                keep = false;
-            } else if (strcmp(type, "output") == 0 && from_node == node_index && from_output == connector_index) {
-                keep = false;
-            }
-            if (keep) {
-                new_count++;
-                lua_newtable(L);
-                lua_pushinteger(L, from_node);
-                lua_setfield(L, -2, "from_node");
-                lua_pushinteger(L, from_output);
-                lua_setfield(L, -2, "from_output");
-                lua_pushinteger(L, to_node);
-                lua_setfield(L, -2, "to_node");
-                lua_pushinteger(L, to_input);
-                lua_setfield(L, -2, "to_input");
-                lua_rawseti(L, -3, new_count);
-            }
+            lua_newtable(L);
+            lua_rawgeti(L, LUA_REGISTRYINDEX, path->key_refs[i]);
+            lua_pushvalue(L, -2);
+            lua_rawset(L, -4);
         }
-        lua_pop(L, 1);
+        lua_remove(L, -2);
     }
-    lua_setglobal(L, "connections");
+    lua_rawgeti(L, LUA_REGISTRYINDEX, path->key_refs[path->depth - 1]);
+    lua_pushnumber(L, value);
+    lua_rawset(L, -3);
     lua_pop(L, 1);
-}
\ No newline at end of file
+}
@@ -0,0 +1,518 @@
+#include "module_node.h"
+#include "module_log.h"
+#include "module_lua.h"
+#include <lua.h>
+#include <lauxlib.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NODES_METATABLE "node2d.nodes"
+#define NODE_METATABLE "node2d.node"
+
+void node_store_init(NodeStore *store) {
+    memset(store, 0, sizeof(*store));
+    store->free_slot = -1;
+    store->next_id = 1;
+}
+
+void node_store_set_listener(NodeStore *store, NodeChangeListener listener, void *user) {
+    store->listener = listener;
+    store->listener_user = user;
+}
+
+void node_store_notify(NodeStore *store, int index, bool structural) {
+    if (store->listener) {
+        store->listener(store->listener_user, index, structural);
+    }
+}
+
+void node_store_free(NodeStore *store) {
+    free(store->x);
+    free(store->y);
+    free(store->size);
+    free(store->r);
+    free(store->g);
+    free(store->b);
+    free(store->inputs);
+    free(store->outputs);
+    free(store->text_id);
+    free(store->kernel_id);
+    free(store->value);
+    free(store->id);
+    free(store->slot);
+    free(store->text_pool);
+    free(store->slot_index);
+    free(store->slot_generation);
+    free(store->id_index);
+    free(store->moved);
+    node_store_init(store);
+}
+
+// Return a slot to the free list; the new generation invalidates its handles
+static void release_slot(NodeStore *store, int slot) {
+    uint16_t generation = store->slot_generation[slot];
+    store->slot_generation[slot] = generation == NODE_HANDLE_GENERATION_MAX ? 1 : generation + 1;
+    store->slot_index[slot] = store->free_slot;
+    store->free_slot = slot;
+}
+
+void node_store_clear(NodeStore *store) {
+    for (int i = 0; i < store->count; i++) {
+        release_slot(store, store->slot[i]);
+        store->id_index[store->id[i]] = -1;
+    }
+    store->count = 0;
+    store->next_id = 1;
+    store->text_pool_size = 0;
+    store->geometry_version++;
+    store->moved_count = 0;
+    node_store_notify(store, -1, true);
+}
+
+static bool grow_array(void **array, int capacity, size_t element_size) {
+    void *grown = realloc(*array, capacity * element_size);
+    if (!grown) return false;
+    *array = grown;
+    return true;
+}
+
+static bool grow_nodes(NodeStore *store) {
+    int capacity = store->capacity ? store->capacity * 2 : 64;
+    bool ok = grow_array((void**)&store->x, capacity, sizeof(float)) &&
+              grow_array((void**)&store->y, capacity, sizeof(float)) &&
+              grow_array((void**)&store->size, capacity, sizeof(float)) &&
+              grow_array((void**)&store->r, capacity, sizeof(float)) &&
+              grow_array((void**)&store->g, capacity, sizeof(float)) &&
+              grow_array((void**)&store->b, capacity, sizeof(float)) &&
+              grow_array((void**)&store->inputs, capacity, sizeof(int)) &&
+              grow_array((void**)&store->outputs, capacity, sizeof(int)) &&
+              grow_array((void**)&store->text_id, capacity, sizeof(int)) &&
+              grow_array((void**)&store->kernel_id, capacity, sizeof(int)) &&
+              grow_array((void**)&store->value, capacity, sizeof(float)) &&
+              grow_array((void**)&store->id, capacity, sizeof(int)) &&
+              grow_array((void**)&store->slot, capacity, sizeof(int));
+    if (!ok) {
+        // Arrays that did grow keep their new size; capacity stays at the smallest
+        LOG_ERROR(LOG_CATEGORY_GENERAL, "Failed to grow node store to %d nodes", capacity);
+        return false;
+    }
+    store->capacity = capacity;
+    return true;
+}
+
+static int alloc_slot(NodeStore *store) {
+    if (store->free_slot >= 0) {
+        int slot = store->free_slot;
+        store->free_slot = store->slot_index[slot];
+        return slot;
+    }
+    if (store->slot_count == store->slot_capacity) {
+        int capacity = store->slot_capacity ? store->slot_capacity * 2 : 64;
+        if (capacity > (int)NODE_HANDLE_SLOT_MASK + 1) capacity = (int)NODE_HANDLE_SLOT_MASK + 1;
+        if (capacity == store->slot_capacity ||
+            !grow_array((void**)&store->slot_index, capacity, sizeof(int)) ||
+            !grow_array((void**)&store->slot_generation, capacity, sizeof(uint16_t))) {
+            LOG_ERROR(LOG_CATEGORY_GENERAL, "Failed to grow node handles to %d slots", capacity);
+            return -1;
+        }
+        store->slot_capacity = capacity;
+    }
+    int slot = store->slot_count++;
+    store->slot_generation[slot] = 1;
+    return slot;
+}
+
+// Make id_index cover ids up to and including id
+static bool reserve_ids(NodeStore *store, int id) {
+    if (id < store->id_capacity) return true;
+    int capacity = store->id_capacity ? store->id_capacity : 64;
+    while (capacity <= id) capacity *= 2;
+    if (!grow_array((void**)&store->id_index, capacity, sizeof(int))) {
+        LOG_ERROR(LOG_CATEGORY_GENERAL, "Failed to grow node id map to %d ids", capacity);
+        return false;
+    }
+    memset(store->id_index + store->id_capacity, -1, (capacity - store->id_capacity) * sizeof(int));
+    store->id_capacity = capacity;
+    return true;
+}
+
+static bool reserve_text(NodeStore *store, int length) {
+    if (store->text_pool_size + length <= store->text_pool_capacity) return true;
+    int capacity = store->text_pool_capacity ? store->text_pool_capacity : 1024;
+    while (capacity < store->text_pool_size + length) capacity *= 2;
+    char *pool = realloc(store->text_pool, capacity);
+    if (!pool) {
+        LOG_ERROR(LOG_CATEGORY_GENERAL, "Failed to grow node text pool to %d bytes", capacity);
+        return false;
+    }
+    store->text_pool = pool;
+    store->text_pool_capacity = capacity;
+    return true;
+}
+
+// Copy a label into the pool; offset 0 is the shared empty label
+static int intern_text(NodeStore *store, const char *text) {
+    if (store->text_pool_size == 0) {
+        if (!reserve_text(store, 1)) return -1;
+        store->text_pool[0] = '\0';
+        store->text_pool_size = 1;
+    }
+    if (text[0] == '\0') return 0;
+    int length = (int)strlen(text) + 1;
+    if (!reserve_text(store, length)) return -1;
+    int offset = store->text_pool_size;
+    memcpy(store->text_pool + offset, text, length);
+    store->text_pool_size += length;
+    return offset;
+}
+
+int node_store_add(NodeStore *store, int id, float x, float y, float size, float r, float g, float b,
+                   int inputs, int outputs, const char *text) {
+    if (store->count == store->capacity && !grow_nodes(store)) {
+        return -1;
+    }
+    if (id <= 0 || id > LUA_NODE_ID_MAX || node_store_find_id(store, id) >= 0) {
+        if (id != 0) {
+            LOG_WARN(LOG_CATEGORY_LUA, "Node id %d is invalid or taken; using %d", id, store->next_id);
+        }
+        id = store->next_id;
+        if (id > LUA_NODE_ID_MAX) {
+            LOG_ERROR(LOG_CATEGORY_GENERAL, "Out of node ids");
+            return -1;
+        }
+    }
+    int text_id = intern_text(store, text ? text : "");
+    if (text_id < 0 || !reserve_ids(store, id)) {
+        return -1;
+    }
+    int slot = alloc_slot(store);
+    if (slot < 0) {
+        return -1;
+    }
+    int index = store->count++;
+    store->x[index] = x;
+    store->y[index] = y;
+    store->size[index] = size;
+    store->r[index] = r;
+    store->g[index] = g;
+    store->b[index] = b;
+    store->inputs[index] = inputs;
+    store->outputs[index] = outputs;
+    store->text_id[index] = text_id;
+    store->kernel_id[index] = 0;
+    store->value[index] = 0.0f;
+    store->id[index] = id;
+    store->slot[index] = slot;
+    store->slot_index[slot] = index;
+    store->id_index[id] = index;
+    if (id >= store->next_id) store->next_id = id + 1;
+    store->geometry_version++;
+    node_store_notify(store, -1, true);
+    return index;
+}
+
+int node_store_remove(NodeStore *store, int index) {
+    if (index < 0 || index >= store->count) return -1;
+    release_slot(store, store->slot[index]);
+    store->id_index[store->id[index]] = -1;
+    store->geometry_version++;
+    int last = --store->count;
+    node_store_notify(store, -1, true);
+    if (index == last) return -1;
+    store->x[index] = store->x[last];
+    store->y[index] = store->y[last];
+    store->size[index] = store->size[last];
+    store->r[index] = store->r[last];
+    store->g[index] = store->g[last];
+    store->b[index] = store->b[last];
+    store->inputs[index] = store->inputs[last];
+    store->outputs[index] = store->outputs[last];
+    store->text_id[index] = store->text_id[last];
+    store->kernel_id[index] = store->kernel_id[last];
+    store->value[index] = store->value[last];
+    store->id[index] = store->id[last];
+    store->slot[index] = store->slot[last];
+    store->slot_index[store->slot[index]] = index;
+    store->id_index[store->id[index]] = index;
+    return last;
+}
+
+NodeHandle node_store_handle(const NodeStore *store, int index) {
+    if (index < 0 || index >= store->count) return NODE_HANDLE_NONE;
+    int slot = store->slot[index];
+    return ((NodeHandle)store->slot_generation[slot] << NODE_HANDLE_SLOT_BITS) | (NodeHandle)slot;
+}
+
+int node_store_index(const NodeStore *store, NodeHandle handle) {
+    NodeHandle slot = handle & NODE_HANDLE_SLOT_MASK;
+    if (handle == NODE_HANDLE_NONE || slot >= (NodeHandle)store->slot_count ||
+        store->slot_generation[slot] != handle >> NODE_HANDLE_SLOT_BITS) {
+        return -1;
+    }
+    return store->slot_index[slot];
+}
+
+int node_store_find_id(const NodeStore *store, int id) {
+    if (id <= 0 || id >= store->id_capacity) return -1;
+    return store->id_index[id];
+}
+
+const char* node_store_text(const NodeStore *store, int index) {
+    if (index < 0 || index >= store->count || !store->text_pool) return "";
+    return store->text_pool + store->text_id[index];
+}
+
+void node_store_set_position(NodeStore *store, int index, float x, float y) {
+    if (index < 0 || index >= store->count) return;
+    store->x[index] = x;
+    store->y[index] = y;
+}
+
+void node_store_mark_moved(NodeStore *store, int index) {
+    NodeHandle handle = node_store_handle(store, index);
+    if (store->moved_count > 0 && store->moved[store->moved_count - 1] == handle) {
+        return; // x then y of the same node
+    }
+    if (store->moved_count == store->moved_capacity && store->moved_count < store->count) {
+        int capacity = store->moved_capacity ? store->moved_capacity * 2 : 64;
+        if (grow_array((void**)&store->moved, capacity, sizeof(NodeHandle))) {
+            store->moved_capacity = capacity;
+        }
+    }
+    if (store->moved_count >= store->count || store->moved_count == store->moved_capacity) {
+        // Most nodes moved, or out of memory: one rebuild covers them all
+        store->geometry_version++;
+        store->moved_count = 0;
+        return;
+    }
+    store->moved[store->moved_count++] = handle;
+}
+
+void node_store_connector_position(const NodeStore *store, int index, bool output, int connector, float *x, float *y) {
+    int count = output ? store->outputs[index] : store->inputs[index];
+    float half_size = store->size[index] / 2.0f;
+    *x = output ? store->x[index] + half_size : store->x[index] - half_size;
+    *y = store->y[index] + connector * NODE_CONNECTOR_SPACING - (count - 1) * NODE_CONNECTOR_SPACING / 2.0f;
+}
+
+bool node_store_set_text(NodeStore *store, int index, const char *text) {
+    if (index < 0 || index >= store->count) return false;
+    int text_id = intern_text(store, text ? text : "");
+    if (text_id < 0) return false;
+    store->text_id[index] = text_id;
+    return true;
+}
+
+const char* node_store_kernel(const NodeStore *store, int index) {
+    if (index < 0 || index >= store->count || !store->text_pool) return "";
+    return store->text_pool + store->kernel_id[index];
+}
+
+bool node_store_set_kernel(NodeStore *store, int index, const char *kernel) {
+    if (index < 0 || index >= store->count) return false;
+    int kernel_id = intern_text(store, kernel ? kernel : "");
+    if (kernel_id < 0) return false;
+    store->kernel_id[index] = kernel_id;
+    node_store_notify(store, index, true);
+    return true;
+}
+
+bool node_store_load_lua(NodeStore *store, lua_State *L) {
+    lua_getglobal(L, "nodes");
+    bool bound = luaL_testudata(L, -1, NODES_METATABLE) != NULL;
+    lua_pop(L, 1);
+    if (bound) {
+        return true;
+    }
+    node_store_clear(store);
+    int count = lua_utils_get_nodes_count(L);
+    if (count == 0) {
+        return true;
+    }
+    // One pass over the Lua table into a snapshot, then copy into the arrays
+    LuaNode *snapshot = malloc(count * sizeof(LuaNode));
+    if (!snapshot) {
+        LOG_ERROR(LOG_CATEGORY_GENERAL, "Failed to allocate node snapshot of %d nodes", count);
+        return false;
+    }
+    count = lua_utils_read_nodes(L, snapshot, count);
+    bool ok = true;
+    for (int i = 0; i < count && ok; i++) {
+        const LuaNode *node = &snapshot[i];
+        int index = node_store_add(store, node->id, node->x, node->y, node->size, node->r, node->g, node->b,
+                                   node->inputs, node->outputs, node->text);
+        ok = index >= 0 && node_store_set_kernel(store, index, node->kernel);
+        if (ok) store->value[index] = node->value;
+    }
+    free(snapshot);
+    LOG_INFO(LOG_CATEGORY_LUA, "Loaded %d nodes", store->count);
+    return ok;
+}
+
+// Lua proxies: `nodes` is a userdata holding the store pointer, nodes[i] a cached
+// userdata holding the store pointer and the node's handle, so a proxy keeps naming
+// the same node when removals move it to another index
+typedef struct {
+    NodeStore *store;
+    NodeHandle handle;
+} NodeProxy;
+
+// Index of the proxied node; raises an error once the node was removed
+static int check_node(lua_State *L, NodeStore **store) {
+    NodeProxy *proxy = luaL_checkudata(L, 1, NODE_METATABLE);
+    int index = node_store_index(proxy->store, proxy->handle);
+    if (index < 0) {
+        luaL_error(L, "node no longer exists");
+    }
+    *store = proxy->store;
+    return index;
+}
+
+static int l_node_index(lua_State *L) {
+    NodeStore *store;
+    int i = check_node(L, &store);
+    switch (lua_utils_node_field(L, 2)) {
+    case LUA_NODE_FIELD_X: lua_pushnumber(L, store->x[i]); break;
+    case LUA_NODE_FIELD_Y: lua_pushnumber(L, store->y[i]); break;
+    case LUA_NODE_FIELD_SIZE: lua_pushnumber(L, store->size[i]); break;
+    case LUA_NODE_FIELD_R: lua_pushnumber(L, store->r[i]); break;
+    case LUA_NODE_FIELD_G: lua_pushnumber(L, store->g[i]); break;
+    case LUA_NODE_FIELD_B: lua_pushnumber(L, store->b[i]); break;
+    case LUA_NODE_FIELD_INPUTS: lua_pushinteger(L, store->inputs[i]); break;
+    case LUA_NODE_FIELD_OUTPUTS: lua_pushinteger(L, store->outputs[i]); break;
+    case LUA_NODE_FIELD_TEXT: lua_pushstring(L, node_store_text(store, i)); break;
+    case LUA_NODE_FIELD_ID: lua_pushinteger(L, store->id[i]); break;
+    case LUA_NODE_FIELD_KERNEL: lua_pushstring(L, node_store_kernel(store, i)); break;
+    case LUA_NODE_FIELD_VALUE: lua_pushnumber(L, store->value[i]); break;
+    default: lua_pushnil(L); break;
+    }
+    return 1;
+}
+
+// Writes land in the arrays the renderer reads. Geometry edits queue the node for the
+// spatial index; value and connector edits reach the evaluation listener.
+static int l_node_newindex(lua_State *L) {
+    NodeStore *store;
+    int i = check_node(L, &store);
+    switch (lua_utils_node_field(L, 2)) {
+    case LUA_NODE_FIELD_X:
+        store->x[i] = (float)luaL_checknumber(L, 3);
+        node_store_mark_moved(store, i);
+        break;
+    case LUA_NODE_FIELD_Y:
+        store->y[i] = (float)luaL_checknumber(L, 3);
+        node_store_mark_moved(store, i);
+        break;
+    case LUA_NODE_FIELD_SIZE:
+        store->size[i] = (float)luaL_checknumber(L, 3);
+        node_store_mark_moved(store, i);
+        break;
+    case LUA_NODE_FIELD_R: store->r[i] = (float)luaL_checknumber(L, 3); break;
+    case LUA_NODE_FIELD_G: store->g[i] = (float)luaL_checknumber(L, 3); break;
+    case LUA_NODE_FIELD_B: store->b[i] = (float)luaL_checknumber(L, 3); break;
+    case LUA_NODE_FIELD_INPUTS:
+        store->inputs[i] = (int)luaL_checkinteger(L, 3);
+        node_store_mark_moved(store, i);
+        node_store_notify(store, i, true);
+        break;
+    case LUA_NODE_FIELD_OUTPUTS:
+        store->outputs[i] = (int)luaL_checkinteger(L, 3);
+        node_store_mark_moved(store, i);
+        node_store_notify(store, i, true);
+        break;
+    case LUA_NODE_FIELD_TEXT:
+        if (!node_store_set_text(store, i, luaL_checkstring(L, 3))) {
+            return luaL_error(L, "out of memory setting node text");
+        }
+        break;
+    case LUA_NODE_FIELD_KERNEL:
+        if (!node_store_set_kernel(store, i, luaL_checkstring(L, 3))) {
+            return luaL_error(L, "out of memory setting node kernel");
+        }
+        break;
+    case LUA_NODE_FIELD_VALUE:
+        store->value[i] = (float)luaL_checknumber(L, 3);
+        node_store_notify(store, i, false);
+        break;
+    case LUA_NODE_FIELD_ID:
+        return luaL_error(L, "node ids are read-only");
+    default:
+        return luaL_error(L, "node has no field '%s'", luaL_checkstring(L, 2));
+    }
+    lua_utils_request_redraw(L);
+    return 0;
+}
+
+static int l_node_tostring(lua_State *L) {
+    NodeProxy *proxy = luaL_checkudata(L, 1, NODE_METATABLE);
+    int index = node_store_index(proxy->store, proxy->handle);
+    if (index < 0) {
+        lua_pushliteral(L, "node (removed)");
+    } else {
+        lua_pushfstring(L, "node %d", proxy->store->id[index]);
+    }
+    return 1;
+}
+
+// nodes[i]: proxies are created on first access and cached in the collection's user value;
+// a cached proxy is replaced when a removal moved another node to position i
+static int l_nodes_index(lua_State *L) {
+    NodeStore *store = *(NodeStore**)luaL_checkudata(L, 1, NODES_METATABLE);
+    lua_Integer i = lua_isinteger(L, 2) ? lua_tointeger(L, 2) : 0;
+    if (i < 1 || i > store->count) {
+        lua_pushnil(L);
+        return 1;
+    }
+    NodeHandle handle = node_store_handle(store, (int)i - 1);
+    lua_getiuservalue(L, 1, 1);
+    if (lua_rawgeti(L, -1, i) == LUA_TUSERDATA && ((NodeProxy*)lua_touserdata(L, -1))->handle == handle) {
+        return 1;
+    }
+    lua_pop(L, 1);
+    NodeProxy *proxy = lua_newuserdatauv(L, sizeof(NodeProxy), 0);
+    proxy->store = store;
+    proxy->handle = handle;
+    luaL_setmetatable(L, NODE_METATABLE);
+    lua_pushvalue(L, -1);
+    lua_rawseti(L, -3, i);
+    return 1;
+}
+
+static int l_nodes_len(lua_State *L) {
+    NodeStore *store = *(NodeStore**)luaL_checkudata(L, 1, NODES_METATABLE);
+    lua_pushinteger(L, store->count);
+    return 1;
+}
+
+static int l_nodes_newindex(lua_State *L) {
+    return luaL_error(L, "nodes are owned by the editor; assign fields of nodes[i] instead");
+}
+
+void node_store_bind_lua(NodeStore *store, lua_State *L) {
+    if (luaL_newmetatable(L, NODE_METATABLE)) {
+        lua_pushcfunction(L, l_node_index);
+        lua_setfield(L, -2, "__index");
+        lua_pushcfunction(L, l_node_newindex);
+        lua_setfield(L, -2, "__newindex");
+        lua_pushcfunction(L, l_node_tostring);
+        lua_setfield(L, -2, "__tostring");
+    }
+    lua_pop(L, 1);
+    if (luaL_newmetatable(L, NODES_METATABLE)) {
+        lua_pushcfunction(L, l_nodes_index);
+        lua_setfield(L, -2, "__index");
+        lua_pushcfunction(L, l_nodes_newindex);
+        lua_setfield(L, -2, "__newindex");
+        lua_pushcfunction(L, l_nodes_len);
+        lua_setfield(L, -2, "__len");
+    }
+    lua_pop(L, 1);
+
+    NodeStore **nodes = lua_newuserdatauv(L, sizeof(NodeStore*), 1);
+    *nodes = store;
+    luaL_setmetatable(L, NODES_METATABLE);
+    lua_createtable(L, store->count, 0); // proxy cache
+    lua_setiuservalue(L, -2, 1);
+    lua_setglobal(L, "nodes");
+    lua_utils_nodes_replaced(L); // our own assignment is not a script replacing the nodes
+}
@@ -0,0 +1,261 @@
+#include "module_reload.h"
+#include "module_log.h"
+#include <stdlib.h>
+#include <string.h>
+
+bool script_snapshot_take(lua_State *L, ScriptSnapshot *snapshot) {
+    memset(snapshot, 0, sizeof(*snapshot));
+    int node_count = lua_utils_get_nodes_count(L);
+    int connection_count;
+    const LuaConnection *connections = lua_utils_get_connections(L, &connection_count);
+    snapshot->nodes = malloc((node_count > 0 ? node_count : 1) * sizeof(LuaNode));
+    snapshot->connections = malloc((connection_count > 0 ? connection_count : 1) * sizeof(LuaConnection));
+    if (!snapshot->nodes || !snapshot->connections) {
+        LOG_ERROR(LOG_CATEGORY_LUA, "Failed to allocate script snapshot");
+        script_snapshot_free(snapshot);
+        return false;
+    }
+    int read_count = lua_utils_read_nodes(L, snapshot->nodes, node_count);
+    snapshot->node_count = read_count < node_count ? read_count : node_count;
+    memcpy(snapshot->connections, connections, connection_count * sizeof(LuaConnection));
+    snapshot->connection_count = connection_count;
+
+    // Labels and kernel names are owned by the state, which may be closed; copy them out
+    size_t text_size = 0;
+    for (int i = 0; i < snapshot->node_count; i++) {
+        text_size += strlen(snapshot->nodes[i].text) + strlen(snapshot->nodes[i].kernel) + 2;
+    }
+    snapshot->text_pool = malloc(text_size > 0 ? text_size : 1);
+    if (!snapshot->text_pool) {
+        LOG_ERROR(LOG_CATEGORY_LUA, "Failed to allocate %zu bytes of snapshot labels", text_size);
+        script_snapshot_free(snapshot);
+        return false;
+    }
+    char *cursor = snapshot->text_pool;
+    for (int i = 0; i < snapshot->node_count; i++) {
+        const char **strings[2] = { &snapshot->nodes[i].text, &snapshot->nodes[i].kernel };
+        for (int k = 0; k < 2; k++) {
+            size_t length = strlen(*strings[k]) + 1;
+            memcpy(cursor, *strings[k], length);
+            *strings[k] = cursor;
+            cursor += length;
+        }
+    }
+    return true;
+}
+
+void script_snapshot_free(ScriptSnapshot *snapshot) {
+    free(snapshot->nodes);
+    free(snapshot->text_pool);
+    free(snapshot->connections);
+    memset(snapshot, 0, sizeof(*snapshot));
+}
+
+typedef struct {
+    int id;
+    int index;   // into the snapshot's nodes
+} SnapshotId;
+
+static int compare_ids(const void *a, const void *b) {
+    const SnapshotId *left = a, *right = b;
+    return left->id < right->id ? -1 : left->id > right->id;
+}
+
+static SnapshotId* sorted_ids(const ScriptSnapshot *snapshot) {
+    SnapshotId *ids = malloc((snapshot->node_count > 0 ? snapshot->node_count : 1) * sizeof(SnapshotId));
+    if (!ids) return NULL;
+    for (int i = 0; i < snapshot->node_count; i++) {
+        ids[i] = (SnapshotId){ snapshot->nodes[i].id, i };
+    }
+    qsort(ids, snapshot->node_count, sizeof(SnapshotId), compare_ids);
+    return ids;
+}
+
+// Write the fields that differ between two versions of one node into the live node
+static bool apply_node_fields(NodeStore *store, int i, const LuaNode *old_node, const LuaNode *new_node) {
+    bool changed = false;
+    if (old_node->x != new_node->x) { store->x[i] = new_node->x; changed = true; }
+    if (old_node->y != new_node->y) { store->y[i] = new_node->y; changed = true; }
+    if (old_node->size != new_node->size) { store->size[i] = new_node->size; changed = true; }
+    if (old_node->r != new_node->r) { store->r[i] = new_node->r; changed = true; }
+    if (old_node->g != new_node->g) { store->g[i] = new_node->g; changed = true; }
+    if (old_node->b != new_node->b) { store->b[i] = new_node->b; changed = true; }
+    if (old_node->inputs != new_node->inputs || old_node->outputs != new_node->outputs) {
+        store->inputs[i] = new_node->inputs;
+        store->outputs[i] = new_node->outputs;
+        node_store_notify(store, i, true);
+        changed = true;
+    }
+    if (old_node->value != new_node->value) {
+        store->value[i] = new_node->value;
+        node_store_notify(store, i, false);
+        changed = true;
+    }
+    if (strcmp(old_node->text, new_node->text) != 0) {
+        node_store_set_text(store, i, new_node->text);
+        changed = true;
+    }
+    if (strcmp(old_node->kernel, new_node->kernel) != 0) {
+        node_store_set_kernel(store, i, new_node->kernel);
+        changed = true;
+    }
+    return changed;
+}
+
+// Nodes are matched by id, so edits in the editor (moves, deletions) and in the script
+// combine: only ids whose script entry changed touch the live graph. Ids dropped from the
+// script are removed with their connections; ids the editor deleted stay deleted.
+static bool apply_node_changes(lua_State *L, NodeStore *store, const ScriptSnapshot *before,
+                               const ScriptSnapshot *after, int *changed, int *added, int *removed) {
+    *changed = *added = *removed = 0;
+    SnapshotId *old_ids = sorted_ids(before);
+    SnapshotId *new_ids = sorted_ids(after);
+    if (!old_ids || !new_ids) {
+        LOG_ERROR(LOG_CATEGORY_LUA, "Failed to allocate node diff");
+        free(old_ids);
+        free(new_ids);
+        return false;
+    }
+    bool written = false;
+    int i = 0, j = 0;
+    while (i < before->node_count || j < after->node_count) {
+        int order = i == before->node_count ? 1 :
+                    j == after->node_count ? -1 : compare_ids(&old_ids[i], &new_ids[j]);
+        if (order < 0) {
+            int id = old_ids[i].id;
+            int live = node_store_find_id(store, id);
+            if (live >= 0) {
+                lua_utils_remove_node_connections(L, id);
+                node_store_remove(store, live);
+                (*removed)++;
+            }
+            i++;
+        } else if (order > 0) {
+            const LuaNode *node = &after->nodes[new_ids[j].index];
+            int live = node_store_find_id(store, node->id);
+            if (live >= 0) {
+                // The live graph already has a node with this id; take the script's version of it
+                store->x[live] = node->x;
+                store->y[live] = node->y;
+                store->size[live] = node->size;
+                store->r[live] = node->r;
+                store->g[live] = node->g;
+                store->b[live] = node->b;
+                store->inputs[live] = node->inputs;
+                store->outputs[live] = node->outputs;
+                store->value[live] = node->value;
+                node_store_set_text(store, live, node->text);
+                node_store_set_kernel(store, live, node->kernel);
+                node_store_notify(store, live, true);
+                written = true;
+                (*added)++;
+            } else {
+                int index = node_store_add(store, node->id, node->x, node->y, node->size, node->r, node->g, node->b,
+                                           node->inputs, node->outputs, node->text);
+                if (index >= 0) {
+                    store->value[index] = node->value;
+                    node_store_set_kernel(store, index, node->kernel);
+                    (*added)++;
+                }
+            }
+            j++;
+        } else {
+            int live = node_store_find_id(store, new_ids[j].id);
+            if (live >= 0 && apply_node_fields(store, live, &before->nodes[old_ids[i].index],
+                                               &after->nodes[new_ids[j].index])) {
+                (*changed)++;
+                written = true;
+            }
+            i++;
+            j++;
+        }
+    }
+    if (written) {
+        store->geometry_version++; // fields were written directly
+    }
+    free(old_ids);
+    free(new_ids);
+    return true;
+}
+
+static int compare_connections(const void *a, const void *b) {
+    const LuaConnection *left = a, *right = b;
+    if (left->from_node != right->from_node) return left->from_node < right->from_node ? -1 : 1;
+    if (left->from_output != right->from_output) return left->from_output < right->from_output ? -1 : 1;
+    if (left->to_node != right->to_node) return left->to_node < right->to_node ? -1 : 1;
+    if (left->to_input != right->to_input) return left->to_input < right->to_input ? -1 : 1;
+    return 0;
+}
+
+static LuaConnection* sorted_connections(const ScriptSnapshot *snapshot) {
+    LuaConnection *sorted = malloc((snapshot->connection_count > 0 ? snapshot->connection_count : 1) * sizeof(LuaConnection));
+    if (!sorted) return NULL;
+    memcpy(sorted, snapshot->connections, snapshot->connection_count * sizeof(LuaConnection));
+    qsort(sorted, snapshot->connection_count, sizeof(LuaConnection), compare_connections);
+    return sorted;
+}
+
+// Merge the two sorted versions: edges only in before are removed, edges only in after added
+static bool apply_connection_changes(lua_State *L, const ScriptSnapshot *before, const ScriptSnapshot *after,
+                                     int *added, int *removed) {
+    *added = *removed = 0;
+    LuaConnection *old_edges = sorted_connections(before);
+    LuaConnection *new_edges = sorted_connections(after);
+    if (!old_edges || !new_edges) {
+        LOG_ERROR(LOG_CATEGORY_LUA, "Failed to allocate connection diff");
+        free(old_edges);
+        free(new_edges);
+        return false;
+    }
+    int i = 0, j = 0;
+    while (i < before->connection_count || j < after->connection_count) {
+        int order = i == before->connection_count ? 1 :
+                    j == after->connection_count ? -1 : compare_connections(&old_edges[i], &new_edges[j]);
+        if (order < 0) {
+            if (lua_utils_remove_connection(L, &old_edges[i])) (*removed)++;
+            i++;
+        } else if (order > 0) {
+            const LuaConnection *edge = &new_edges[j];
+            if (!lua_utils_has_connection(L, edge)) {
+                lua_utils_add_connection(L, edge->from_node, edge->from_output, edge->to_node, edge->to_input);
+                (*added)++;
+            }
+            j++;
+        } else {
+            i++;
+            j++;
+        }
+    }
+    free(old_edges);
+    free(new_edges);
+    return true;
+}
+
+bool script_reload(lua_State *L, NodeStore *store, const char *script_path, ScriptSnapshot *baseline) {
+    Uint64 start_ns = SDL_GetTicksNS();
+    lua_State *scratch = lua_utils_init(script_path);
+    if (!scratch) {
+        LOG_WARN(LOG_CATEGORY_LUA, "Reload of '%s' failed; keeping the current graph", script_path);
+        return false;
+    }
+    ScriptSnapshot next;
+    if (!script_snapshot_take(scratch, &next)) {
+        lua_utils_cleanup(scratch);
+        return false;
+    }
+
+    int changed, added_nodes, removed_nodes;
+    apply_node_changes(L, store, baseline, &next, &changed, &added_nodes, &removed_nodes);
+    int added_connections, removed_connections;
+    apply_connection_changes(L, baseline, &next, &added_connections, &removed_connections);
+    int config_values = lua_utils_merge_config(L, scratch, "camera");
+
+    lua_utils_cleanup(scratch);
+    script_snapshot_free(baseline);
+    *baseline = next;
+    lua_utils_request_redraw(L);
+    LOG_INFO(LOG_CATEGORY_LUA, "Reloaded '%s' in %.2f ms: nodes %d changed +%d -%d, connections +%d -%d, %d config values",
+             script_path, (SDL_GetTicksNS() - start_ns) / 1e6, changed, added_nodes, removed_nodes,
+             added_connections, removed_connections, config_values);
+    return true;
+}
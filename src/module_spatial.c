@@ -0,0 +1,309 @@
+#include "module_spatial.h"
+#include "module_log.h"
+#include <limits.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+enum {
+    SPATIAL_MIN_BUCKETS = 1024,      // power of two
+    SPATIAL_MAX_BODY_CELLS = 64      // bodies covering more cells go on the large list
+};
+
+// Bodies on the large list carry this cell; every body query checks them
+#define SPATIAL_LARGE_CELL INT_MIN
+
+typedef struct {
+    int cell_x, cell_y;
+    int node;
+    int kind;
+    int connector;
+    int chain_prev, chain_next;  // neighbours in the bucket (or large list), -1 ends
+    int node_next;               // next entry of the same node; free list link when unused
+} SpatialEntry;
+
+struct SpatialGrid {
+    float inverse_cell_size;
+    int *buckets;                // first entry per bucket, -1 when empty
+    int bucket_mask;
+    int large_first;             // first oversized body, -1 when none
+    SpatialEntry *entries;
+    int entry_count;             // entries ever handed out; recycled ones are on free_entry
+    int entry_capacity;
+    int free_entry;
+    int *node_first;             // first entry of each node, -1 when none
+    int node_capacity;
+    unsigned int version;        // geometry_version of the store at the last sync
+    bool synced;
+};
+
+static int cell_coord(const SpatialGrid *grid, float value) {
+    return (int)floorf(value * grid->inverse_cell_size);
+}
+
+static int bucket_of(const SpatialGrid *grid, int cell_x, int cell_y) {
+    return (int)(((unsigned int)cell_x * 73856093u ^ (unsigned int)cell_y * 19349663u) & (unsigned int)grid->bucket_mask);
+}
+
+static int* chain_head(SpatialGrid *grid, const SpatialEntry *entry) {
+    if (entry->cell_x == SPATIAL_LARGE_CELL) return &grid->large_first;
+    return &grid->buckets[bucket_of(grid, entry->cell_x, entry->cell_y)];
+}
+
+SpatialGrid* spatial_create(float cell_size) {
+    SpatialGrid *grid = calloc(1, sizeof(SpatialGrid));
+    if (!grid) return NULL;
+    grid->inverse_cell_size = 1.0f / (cell_size > 1.0f ? cell_size : 1.0f);
+    grid->buckets = malloc(SPATIAL_MIN_BUCKETS * sizeof(int));
+    if (!grid->buckets) {
+        free(grid);
+        return NULL;
+    }
+    memset(grid->buckets, -1, SPATIAL_MIN_BUCKETS * sizeof(int));
+    grid->bucket_mask = SPATIAL_MIN_BUCKETS - 1;
+    grid->large_first = -1;
+    grid->free_entry = -1;
+    return grid;
+}
+
+void spatial_destroy(SpatialGrid *grid) {
+    if (!grid) return;
+    free(grid->buckets);
+    free(grid->entries);
+    free(grid->node_first);
+    free(grid);
+}
+
+static int alloc_entry(SpatialGrid *grid) {
+    if (grid->free_entry >= 0) {
+        int entry = grid->free_entry;
+        grid->free_entry = grid->entries[entry].node_next;
+        return entry;
+    }
+    if (grid->entry_count == grid->entry_capacity) {
+        int capacity = grid->entry_capacity ? grid->entry_capacity * 2 : 1024;
+        SpatialEntry *entries = realloc(grid->entries, capacity * sizeof(SpatialEntry));
+        if (!entries) return -1;
+        grid->entries = entries;
+        grid->entry_capacity = capacity;
+    }
+    return grid->entry_count++;
+}
+
+static bool insert_entry(SpatialGrid *grid, int cell_x, int cell_y, int node, int kind, int connector) {
+    int index = alloc_entry(grid);
+    if (index < 0) return false;
+    SpatialEntry *entry = &grid->entries[index];
+    entry->cell_x = cell_x;
+    entry->cell_y = cell_y;
+    entry->node = node;
+    entry->kind = kind;
+    entry->connector = connector;
+    int *head = chain_head(grid, entry);
+    entry->chain_prev = -1;
+    entry->chain_next = *head;
+    if (*head >= 0) grid->entries[*head].chain_prev = index;
+    *head = index;
+    entry->node_next = grid->node_first[node];
+    grid->node_first[node] = index;
+    return true;
+}
+
+static void remove_node_entries(SpatialGrid *grid, int node) {
+    int index = grid->node_first[node];
+    while (index >= 0) {
+        SpatialEntry *entry = &grid->entries[index];
+        int next = entry->node_next;
+        if (entry->chain_prev >= 0) {
+            grid->entries[entry->chain_prev].chain_next = entry->chain_next;
+        } else {
+            *chain_head(grid, entry) = entry->chain_next;
+        }
+        if (entry->chain_next >= 0) {
+            grid->entries[entry->chain_next].chain_prev = entry->chain_prev;
+        }
+        entry->node_next = grid->free_entry;
+        grid->free_entry = index;
+        index = next;
+    }
+    grid->node_first[node] = -1;
+}
+
+static bool insert_node(SpatialGrid *grid, const NodeStore *store, int node) {
+    float half_size = store->size[node] / 2.0f;
+    int min_x = cell_coord(grid, store->x[node] - half_size), max_x = cell_coord(grid, store->x[node] + half_size);
+    int min_y = cell_coord(grid, store->y[node] - half_size), max_y = cell_coord(grid, store->y[node] + half_size);
+    bool ok = true;
+    if ((long long)(max_x - min_x + 1) * (max_y - min_y + 1) > SPATIAL_MAX_BODY_CELLS) {
+        ok = insert_entry(grid, SPATIAL_LARGE_CELL, SPATIAL_LARGE_CELL, node, SPATIAL_BODY, -1);
+    } else {
+        for (int cell_y = min_y; cell_y <= max_y && ok; cell_y++) {
+            for (int cell_x = min_x; cell_x <= max_x && ok; cell_x++) {
+                ok = insert_entry(grid, cell_x, cell_y, node, SPATIAL_BODY, -1);
+            }
+        }
+    }
+    for (int kind = SPATIAL_INPUT; kind <= SPATIAL_OUTPUT && ok; kind++) {
+        int count = kind == SPATIAL_OUTPUT ? store->outputs[node] : store->inputs[node];
+        for (int j = 0; j < count && ok; j++) {
+            float x, y;
+            node_store_connector_position(store, node, kind == SPATIAL_OUTPUT, j, &x, &y);
+            ok = insert_entry(grid, cell_coord(grid, x), cell_coord(grid, y), node, kind, j);
+        }
+    }
+    return ok;
+}
+
+static bool reserve_nodes(SpatialGrid *grid, int count) {
+    if (count <= grid->node_capacity) return true;
+    int capacity = grid->node_capacity ? grid->node_capacity : 256;
+    while (capacity < count) capacity *= 2;
+    int *node_first = realloc(grid->node_first, capacity * sizeof(int));
+    if (!node_first) return false;
+    grid->node_first = node_first;
+    grid->node_capacity = capacity;
+    return true;
+}
+
+static void rebuild(SpatialGrid *grid, const NodeStore *store) {
+    grid->synced = false;
+    if (!reserve_nodes(grid, store->count)) {
+        LOG_ERROR(LOG_CATEGORY_INPUT, "Failed to grow spatial index to %d nodes", store->count);
+        return;
+    }
+    // Keep chains short: about one bucket per node body plus its connectors
+    int buckets = SPATIAL_MIN_BUCKETS;
+    while (buckets < store->count * 4 && buckets < (1 << 24)) buckets *= 2;
+    if (buckets != grid->bucket_mask + 1) {
+        int *grown = realloc(grid->buckets, buckets * sizeof(int));
+        if (grown) {
+            grid->buckets = grown;
+            grid->bucket_mask = buckets - 1;
+        }
+    }
+    memset(grid->buckets, -1, (grid->bucket_mask + 1) * sizeof(int));
+    if (store->count > 0) {
+        memset(grid->node_first, -1, store->count * sizeof(int));
+    }
+    grid->large_first = -1;
+    grid->entry_count = 0;
+    grid->free_entry = -1;
+    for (int i = 0; i < store->count; i++) {
+        if (!insert_node(grid, store, i)) {
+            LOG_ERROR(LOG_CATEGORY_INPUT, "Failed to index node %d of %d", i + 1, store->count);
+            return;
+        }
+    }
+    grid->version = store->geometry_version;
+    grid->synced = true;
+}
+
+void spatial_sync(SpatialGrid *grid, NodeStore *store) {
+    if (!grid->synced || grid->version != store->geometry_version) {
+        rebuild(grid, store);
+    } else {
+        for (int k = 0; k < store->moved_count; k++) {
+            spatial_update_node(grid, store, node_store_index(store, store->moved[k]));
+        }
+    }
+    store->moved_count = 0;
+}
+
+void spatial_update_node(SpatialGrid *grid, const NodeStore *store, int index) {
+    if (!grid->synced || index < 0 || index >= store->count) return;
+    remove_node_entries(grid, index);
+    if (!insert_node(grid, store, index)) {
+        grid->synced = false; // partially indexed; the next sync rebuilds
+    }
+}
+
+void spatial_remove_node(SpatialGrid *grid, const NodeStore *store, int index, int moved_from) {
+    // Only a grid that was current before this one removal can be patched
+    if (!grid->synced || grid->version + 1 != store->geometry_version || index < 0 || index >= grid->node_capacity) {
+        return;
+    }
+    remove_node_entries(grid, index);
+    if (moved_from >= 0 && moved_from < grid->node_capacity) {
+        int entry = grid->node_first[moved_from];
+        for (; entry >= 0; entry = grid->entries[entry].node_next) {
+            grid->entries[entry].node = index;
+        }
+        grid->node_first[index] = grid->node_first[moved_from];
+        grid->node_first[moved_from] = -1;
+    }
+    grid->version = store->geometry_version;
+}
+
+static int compare_hits(const SpatialHit *a, const SpatialHit *b) {
+    if (a->node != b->node) return a->node < b->node ? -1 : 1;
+    if (a->kind != b->kind) return a->kind < b->kind ? -1 : 1;
+    return a->connector < b->connector ? -1 : a->connector > b->connector;
+}
+
+// Insert in order, dropping the last hit when full
+static int insert_hit(SpatialHit *hits, int count, int max_hits, const SpatialHit *hit) {
+    int position = count;
+    while (position > 0 && compare_hits(hit, &hits[position - 1]) < 0) position--;
+    if (position == max_hits) return count;
+    int moved = (count < max_hits ? count : max_hits - 1) - position;
+    memmove(&hits[position + 1], &hits[position], moved * sizeof(SpatialHit));
+    hits[position] = *hit;
+    return count < max_hits ? count + 1 : count;
+}
+
+int spatial_query_connectors(const SpatialGrid *grid, const NodeStore *store, float x, float y, float radius,
+                             SpatialHit *hits, int max_hits) {
+    if (!grid->synced || max_hits <= 0) return 0;
+    int count = 0;
+    int min_x = cell_coord(grid, x - radius), max_x = cell_coord(grid, x + radius);
+    int min_y = cell_coord(grid, y - radius), max_y = cell_coord(grid, y + radius);
+    for (int cell_y = min_y; cell_y <= max_y; cell_y++) {
+        for (int cell_x = min_x; cell_x <= max_x; cell_x++) {
+            int index = grid->buckets[bucket_of(grid, cell_x, cell_y)];
+            for (; index >= 0; index = grid->entries[index].chain_next) {
+                const SpatialEntry *entry = &grid->entries[index];
+                if (entry->kind == SPATIAL_BODY || entry->cell_x != cell_x || entry->cell_y != cell_y ||
+                    entry->node >= store->count) {
+                    continue;
+                }
+                float connector_x, connector_y;
+                node_store_connector_position(store, entry->node, entry->kind == SPATIAL_OUTPUT, entry->connector,
+                                              &connector_x, &connector_y);
+                float dx = x - connector_x, dy = y - connector_y;
+                if (dx * dx + dy * dy <= radius * radius) {
+                    SpatialHit hit = { entry->node, entry->kind, entry->connector };
+                    count = insert_hit(hits, count, max_hits, &hit);
+                }
+            }
+        }
+    }
+    return count;
+}
+
+static bool body_contains(const NodeStore *store, int node, float x, float y) {
+    float half_size = store->size[node] / 2.0f;
+    return x >= store->x[node] - half_size && x <= store->x[node] + half_size &&
+           y >= store->y[node] - half_size && y <= store->y[node] + half_size;
+}
+
+int spatial_query_body(const SpatialGrid *grid, const NodeStore *store, float x, float y) {
+    if (!grid->synced) return -1;
+    int cell_x = cell_coord(grid, x), cell_y = cell_coord(grid, y);
+    int found = -1;
+    int chains[2] = { grid->buckets[bucket_of(grid, cell_x, cell_y)], grid->large_first };
+    for (int c = 0; c < 2; c++) {
+        for (int index = chains[c]; index >= 0; index = grid->entries[index].chain_next) {
+            const SpatialEntry *entry = &grid->entries[index];
+            if (entry->kind != SPATIAL_BODY || entry->node >= store->count || (found >= 0 && entry->node >= found)) {
+                continue;
+            }
+            if (c == 0 && (entry->cell_x != cell_x || entry->cell_y != cell_y)) {
+                continue;
+            }
+            if (body_contains(store, entry->node, x, y)) {
+                found = entry->node;
+            }
+        }
+    }
+    return found;
+}
@@ -0,0 +1,145 @@
+#include "module_watch.h"
+#include "module_log.h"
+#include <SDL3/SDL.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+enum {
+    WATCH_INTERVAL_MS = 250 // poll period, and how long stopping may take
+};
+
+struct FileWatch {
+    char *directory;        // containing directory, "." for a bare file name
+    const char *name;       // file name inside path
+    char *path;
+    Uint32 event_type;
+    SDL_AtomicInt running;
+    SDL_Thread *thread;
+    int inotify_fd;         // -1 when polling
+    SDL_Time modify_time;   // last seen modification time when polling
+};
+
+static void post_change(FileWatch *watch) {
+    SDL_Event event;
+    SDL_zero(event);
+    event.type = watch->event_type;
+    SDL_PushEvent(&event);
+}
+
+#ifdef __linux__
+static bool inotify_open(FileWatch *watch) {
+    watch->inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (watch->inotify_fd < 0) return false;
+    if (inotify_add_watch(watch->inotify_fd, watch->directory, IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        close(watch->inotify_fd);
+        watch->inotify_fd = -1;
+        return false;
+    }
+    return true;
+}
+
+// Block in poll() for at most one interval; one event is posted per batch of matching records
+static void inotify_wait(FileWatch *watch) {
+    struct pollfd descriptor = { watch->inotify_fd, POLLIN, 0 };
+    if (poll(&descriptor, 1, WATCH_INTERVAL_MS) <= 0) return;
+    char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    bool changed = false;
+    ssize_t length;
+    while ((length = read(watch->inotify_fd, buffer, sizeof(buffer))) > 0) {
+        for (char *cursor = buffer; cursor < buffer + length; ) {
+            const struct inotify_event *record = (const struct inotify_event*)cursor;
+            if (record->len > 0 && strcmp(record->name, watch->name) == 0) {
+                changed = true;
+            }
+            cursor += sizeof(struct inotify_event) + record->len;
+        }
+    }
+    if (changed) post_change(watch);
+}
+#endif
+
+static SDL_Time read_modify_time(const char *path) {
+    SDL_PathInfo info;
+    return SDL_GetPathInfo(path, &info) ? info.modify_time : 0;
+}
+
+static void poll_wait(FileWatch *watch) {
+    SDL_Delay(WATCH_INTERVAL_MS);
+    SDL_Time modify_time = read_modify_time(watch->path);
+    if (modify_time != 0 && modify_time != watch->modify_time) {
+        watch->modify_time = modify_time;
+        post_change(watch);
+    }
+}
+
+static int watch_thread(void *data) {
+    FileWatch *watch = data;
+    while (SDL_GetAtomicInt(&watch->running)) {
+#ifdef __linux__
+        if (watch->inotify_fd >= 0) {
+            inotify_wait(watch);
+            continue;
+        }
+#endif
+        poll_wait(watch);
+    }
+    return 0;
+}
+
+FileWatch* watch_start(const char *path, Uint32 event_type) {
+    FileWatch *watch = calloc(1, sizeof(FileWatch));
+    if (!watch) return NULL;
+    watch->path = SDL_strdup(path);
+    const char *slash = strrchr(path, '/');
+    watch->directory = slash ? SDL_strdup(path) : SDL_strdup(".");
+    if (!watch->path || !watch->directory) {
+        watch_stop(watch);
+        return NULL;
+    }
+    if (slash) {
+        watch->directory[slash - path] = '\0';
+        watch->name = watch->path + (slash - path) + 1;
+    } else {
+        watch->name = watch->path;
+    }
+    watch->event_type = event_type;
+    watch->inotify_fd = -1;
+    watch->modify_time = read_modify_time(path);
+#ifdef __linux__
+    if (!inotify_open(watch)) {
+        LOG_WARN(LOG_CATEGORY_GENERAL, "inotify unavailable for '%s', polling for changes", path);
+    }
+#endif
+    SDL_SetAtomicInt(&watch->running, 1);
+    watch->thread = SDL_CreateThread(watch_thread, "file_watch", watch);
+    if (!watch->thread) {
+        LOG_ERROR(LOG_CATEGORY_GENERAL, "Failed to start file watcher: %s", SDL_GetError());
+        watch_stop(watch);
+        return NULL;
+    }
+    LOG_INFO(LOG_CATEGORY_GENERAL, "Watching '%s' for changes (%s)", path, watch->inotify_fd >= 0 ? "inotify" : "polling");
+    return watch;
+}
+
+void watch_stop(FileWatch *watch) {
+    if (!watch) return;
+    if (watch->thread) {
+        SDL_SetAtomicInt(&watch->running, 0);
+        SDL_WaitThread(watch->thread, NULL);
+    }
+#ifdef __linux__
+    if (watch->inotify_fd >= 0) {
+        close(watch->inotify_fd);
+    }
+#endif
+    SDL_free(watch->path);
+    SDL_free(watch->directory);
+    free(watch);
+}